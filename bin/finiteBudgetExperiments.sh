@@ -54,64 +54,64 @@ select opt in "${options[@]}"
 do
     case $opt in
         "Myopic POMCP-IR, MoB")
-            name='fbMB'; solver=0; solverHorizon=1; k=0; break
+            name='fbMB'; measure=1; solver=0; solverHorizon=1; k=0; break
             ;;
         "5-Hor  POMCP-IR, MoB")
-            name='fbMB'; solver=0; solverHorizon=5; k=0; break
+            name='fbMB'; measure=1; solver=0; solverHorizon=5; k=0; break
             ;;
 
 #####################
 
         "Myopic RTBSS-IR, MoB")
-            name='fbMB'; solver=2; solverHorizon=1; k=0; break
+            name='fbMB'; measure=1; solver=2; solverHorizon=1; k=0; break
             ;;
         "3-Hor  RTBSS-IR, MoB")
-            name='fbMB'; solver=2; solverHorizon=3; k=0; break
+            name='fbMB'; measure=1; solver=2; solverHorizon=3; k=0; break
             ;;
 
 #####################
 
         "Myopic RTBSSb,   MoB")
-            name='fbMB'; solver=3; solverHorizon=1; k=0; break
+            name='fbMB'; measure=1; solver=3; solverHorizon=1; k=0; break
             ;;
         "Myopic RTBSSb,   Entropy")
-            name='fb';   solver=3; solverHorizon=1; k=0; break
+            name='fb';   measure=0; solver=3; solverHorizon=1; k=0; break
             ;;
         "5-Hor  RTBSSb,   MoB")
-            name='fbMB'; solver=3; solverHorizon=5; k=0; break
+            name='fbMB'; measure=1; solver=3; solverHorizon=5; k=0; break
             ;;
         "5-Hor  RTBSSb,   Entropy")
-            name='fb';   solver=3; solverHorizon=5; k=0; break
+            name='fb';   measure=0; solver=3; solverHorizon=5; k=0; break
             ;;
 
 #####################
 
         "Myopic rPOMCP,   MoB,     k=1")
-            name='fbMB'; solver=1; solverHorizon=1; k=1; break
+            name='fbMB'; measure=1; solver=1; solverHorizon=1; k=1; break
             ;;
 
         "Myopic rPOMCP,   Entropy, k=1")
-            name='fb';   solver=1; solverHorizon=1; k=1; break
+            name='fb';   measure=0; solver=1; solverHorizon=1; k=1; break
             ;;
 
         "5-Hor  rPOMCP,   MoB,     k=1")
-            name='fbMB'; solver=1; solverHorizon=5; k=1; break
+            name='fbMB'; measure=1; solver=1; solverHorizon=5; k=1; break
             ;;
         "5-Hor  rPOMCP,   MoB,     k=500")
-            name='fbMB'; solver=1; solverHorizon=5; k=500; break
+            name='fbMB'; measure=1; solver=1; solverHorizon=5; k=500; break
             ;;
         "5-Hor  rPOMCP,   MoB,     k=10000")
-            name='fbMB'; solver=1; solverHorizon=5; k=10000; break
+            name='fbMB'; measure=1; solver=1; solverHorizon=5; k=10000; break
             ;;
 
         "5-Hor  rPOMCP,   Entropy, k=1")
-            name='fb';   solver=1; solverHorizon=5; k=1; break
+            name='fb';   measure=0; solver=1; solverHorizon=5; k=1; break
             ;;
         "5-Hor  rPOMCP,   Entropy, k=500")
-            name='fb';   solver=1; solverHorizon=5; k=500; break
+            name='fb';   measure=0; solver=1; solverHorizon=5; k=500; break
             ;;
         "5-Hor  rPOMCP,   Entropy, k=10000")
-            name='fb';   solver=1; solverHorizon=5; k=10000; break
+            name='fb';   measure=0; solver=1; solverHorizon=5; k=10000; break
             ;;
 
         *) echo invalid option;;
@@ -119,7 +119,7 @@ do
 done
 
 # Give hard limit of 3 hours per command
-timeout -s 2 10800 ./$name       $solver  $wSize   $iState     $solverHorizon     $horiz  $iters   $k     $nExp    $resultFolder/$name\_$solver\_$wSize\_$iState\_$solverHorizon\_$horiz\_$iters\_$k\_$nExp\_$budget\_$pLeft\.txt $budget $pLeft & 
+timeout -s 2 10800 ./fb $solver $measure $wSize   $iState     $solverHorizon     $horiz  $iters   $k     $nExp    $resultFolder/$name\_$solver\_$wSize\_$iState\_$solverHorizon\_$horiz\_$iters\_$k\_$nExp\_$budget\_$pLeft\.txt $budget $pLeft & 
 pid=$!
 wait $pid
 
@@ -50,64 +50,64 @@ select opt in "${options[@]}"
 do
     case $opt in
         "Myopic POMCP-IR, MoB")
-            name='myoMB'; solver=0; solverHorizon=1; k=0; break
+            name='myoMB'; measure=1; solver=0; solverHorizon=1; k=0; break
             ;;
         "5-Hor  POMCP-IR, MoB")
-            name='myoMB'; solver=0; solverHorizon=5; k=0; break
+            name='myoMB'; measure=1; solver=0; solverHorizon=5; k=0; break
             ;;
 
 #####################
 
         "Myopic RTBSS-IR, MoB")
-            name='myoMB'; solver=2; solverHorizon=1; k=0; break
+            name='myoMB'; measure=1; solver=2; solverHorizon=1; k=0; break
             ;;
         "3-Hor  RTBSS-IR, MoB")
-            name='myoMB'; solver=2; solverHorizon=3; k=0; break
+            name='myoMB'; measure=1; solver=2; solverHorizon=3; k=0; break
             ;;
 
 #####################
 
         "Myopic RTBSSb,   MoB")
-            name='myoMB'; solver=3; solverHorizon=1; k=0; break
+            name='myoMB'; measure=1; solver=3; solverHorizon=1; k=0; break
             ;;
         "Myopic RTBSSb,   Entropy")
-            name='myo';   solver=3; solverHorizon=1; k=0; break
+            name='myo';   measure=0; solver=3; solverHorizon=1; k=0; break
             ;;
         "5-Hor  RTBSSb,   MoB")
-            name='myoMB'; solver=3; solverHorizon=5; k=0; break
+            name='myoMB'; measure=1; solver=3; solverHorizon=5; k=0; break
             ;;
         "5-Hor  RTBSSb,   Entropy")
-            name='myo';   solver=3; solverHorizon=5; k=0; break
+            name='myo';   measure=0; solver=3; solverHorizon=5; k=0; break
             ;;
 
 #####################
 
         "Myopic rPOMCP,   MoB,     k=1")
-            name='myoMB'; solver=1; solverHorizon=1; k=1; break
+            name='myoMB'; measure=1; solver=1; solverHorizon=1; k=1; break
             ;;
 
         "Myopic rPOMCP,   Entropy, k=1")
-            name='myo';   solver=1; solverHorizon=1; k=1; break
+            name='myo';   measure=0; solver=1; solverHorizon=1; k=1; break
             ;;
 
         "5-Hor  rPOMCP,   MoB,     k=1")
-            name='myoMB'; solver=1; solverHorizon=5; k=1; break
+            name='myoMB'; measure=1; solver=1; solverHorizon=5; k=1; break
             ;;
         "5-Hor  rPOMCP,   MoB,     k=500")
-            name='myoMB'; solver=1; solverHorizon=5; k=500; break
+            name='myoMB'; measure=1; solver=1; solverHorizon=5; k=500; break
             ;;
         "5-Hor  rPOMCP,   MoB,     k=10000")
-            name='myoMB'; solver=1; solverHorizon=5; k=10000; break
+            name='myoMB'; measure=1; solver=1; solverHorizon=5; k=10000; break
             ;;
 
         "5-Hor  rPOMCP,   Entropy, k=1")
-            name='myo';   solver=1; solverHorizon=5; k=1; break
+            name='myo';   measure=0; solver=1; solverHorizon=5; k=1; break
             ;;
         "5-Hor  rPOMCP,   Entropy, k=500")
-            name='myo';   solver=1; solverHorizon=5; k=500; break
+            name='myo';   measure=0; solver=1; solverHorizon=5; k=500; break
             ;;
         "5-Hor  rPOMCP,   Entropy, k=10000")
-            name='myo';   solver=1; solverHorizon=5; k=10000; break
+            name='myo';   measure=0; solver=1; solverHorizon=5; k=10000; break
             ;;
 
         *) echo invalid option;;
@@ -115,7 +115,7 @@ do
 done
 
 # Give hard limit of 3 hours per command
-timeout -s 2 10800 ./$name       $solver  $wSize   $iState     $solverHorizon     $horiz  $iters   $k     $nExp    $resultFolder/$name\_$solver\_$wSize\_$iState\_$solverHorizon\_$horiz\_$iters\_$k\_$nExp\.txt &
+timeout -s 2 10800 ./myo $solver $measure $wSize   $iState     $solverHorizon     $horiz  $iters   $k     $nExp    $resultFolder/$name\_$solver\_$wSize\_$iState\_$solverHorizon\_$horiz\_$iters\_$k\_$nExp\.txt &
 pid=$!
 wait $pid
 
@@ -0,0 +1,74 @@
+#ifndef AI_TOOLBOX_IMPL_PROGRESSIVE_WIDENING_HEADER_FILE
+#define AI_TOOLBOX_IMPL_PROGRESSIVE_WIDENING_HEADER_FILE
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+
+namespace AIToolbox {
+    namespace Impl {
+        /**
+         * @brief This function returns whether an action node can get a new observation child.
+         *
+         * With progressive widening, an action which has been tried N
+         * times can have at most max(1, k * N^alpha) observation
+         * children. A non-positive k disables widening, so that children
+         * can always be added.
+         *
+         * @param children The number of children the action node has.
+         * @param visits The number of times the action has been tried, including the current one.
+         * @param k The widening constant.
+         * @param alpha The widening exponent, in [0, 1].
+         *
+         * @return Whether a new child can be added.
+         */
+        inline bool canWiden(size_t children, unsigned visits, double k, double alpha) {
+            return k <= 0.0 || children < std::max(1.0, k * std::pow(static_cast<double>(visits), alpha));
+        }
+
+        /**
+         * @brief This function returns the child whose observation is closest to the input one.
+         *
+         * Ties are broken in favor of the first child.
+         *
+         * @param children A non-empty map from observations to children.
+         * @param o The observation to match.
+         * @param distance A function returning how far two observations are.
+         *
+         * @return An iterator to the closest child.
+         */
+        template <typename Map, typename D>
+        auto closestObservation(Map & children, size_t o, D distance) -> decltype(children.begin()) {
+            auto best = children.begin();
+            auto bestDistance = distance(best->first, o);
+            for ( auto it = std::next(children.begin()); it != children.end(); ++it ) {
+                auto d = distance(it->first, o);
+                if ( d < bestDistance ) {
+                    best = it;
+                    bestDistance = d;
+                }
+            }
+            return best;
+        }
+
+        /**
+         * @brief This function returns the child whose observation is closest to the input one.
+         *
+         * Observations are compared by their index, so this works best
+         * when close indeces represent similar observations (as positions
+         * on a grid do). Ties are broken in favor of the first child.
+         *
+         * @param children A non-empty map from observations to children.
+         * @param o The observation to match.
+         *
+         * @return An iterator to the closest child.
+         */
+        template <typename Map>
+        auto closestObservation(Map & children, size_t o) -> decltype(children.begin()) {
+            return closestObservation(children, o, [](size_t o1, size_t o2) { return o1 > o2 ? o1 - o2 : o2 - o1; });
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef AI_TOOLBOX_IMPL_UCB_HEADER_FILE
+#define AI_TOOLBOX_IMPL_UCB_HEADER_FILE
+
+#include <cstddef>
+#include <cmath>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace AIToolbox {
+    namespace Impl {
+        /**
+         * @brief This function returns the action with the highest value.
+         *
+         * Ties are broken in favor of the lowest action.
+         *
+         * @param V The values of the actions.
+         * @param A The number of actions, at least 1.
+         *
+         * @return The best action.
+         */
+        inline size_t findBestA(const double * V, size_t A);
+
+        /**
+         * @brief This function returns the action with the highest UCB1 score.
+         *
+         * The score of each action is V[a] + exploration * sqrt(logCount / N[a]).
+         * Actions which have never been tried have infinite score. Ties are
+         * broken in favor of the lowest action.
+         *
+         * The statistics of the actions are read from separate contiguous
+         * arrays, so that when compiled with AVX2 four actions can be scored
+         * at once. The results are exactly the same as the scalar version.
+         *
+         * @param V The values of the actions.
+         * @param N The number of times each action has been tried.
+         * @param A The number of actions, at least 1.
+         * @param logCount The log of the number of visits of the parent node.
+         * @param exploration The exploration constant.
+         *
+         * @return The best action.
+         */
+        inline size_t findBestBonusA(const double * V, const unsigned * N, size_t A, double logCount, double exploration);
+
+        /**
+         * @brief This function returns the action with the highest UCB1 score, using virtual loss.
+         *
+         * This is used when multiple threads search the same tree. Each
+         * search currently in progress below an action counts as a visit
+         * which returned virtualLoss less than the action value, so the
+         * score of each action is:
+         *
+         * V[a] - virtualLoss * P[a] / (N[a] + P[a]) + exploration * sqrt(logCount / (N[a] + P[a]))
+         *
+         * @param V The values of the actions.
+         * @param N The number of times each action has been tried.
+         * @param P The number of searches in progress for each action.
+         * @param A The number of actions, at least 1.
+         * @param logCount The log of the number of visits of the parent node.
+         * @param exploration The exploration constant.
+         * @param virtualLoss The loss to apply for each search in progress.
+         *
+         * @return The best action.
+         */
+        inline size_t findBestBonusA(const double * V, const unsigned * N, const unsigned * P, size_t A, double logCount, double exploration, double virtualLoss);
+
+#ifdef __AVX2__
+        // This reduces the per-lane maxima into the overall one, picking
+        // the lowest index in case of ties.
+        inline void reduceBest(__m256d best, __m256d bestIdx, double & bestValue, size_t & bestAction) {
+            alignas(32) double values[4], indeces[4];
+            _mm256_store_pd(values, best);
+            _mm256_store_pd(indeces, bestIdx);
+
+            for ( int i = 0; i < 4; ++i ) {
+                size_t a = static_cast<size_t>(indeces[i]);
+                if ( values[i] > bestValue || ( values[i] == bestValue && a < bestAction ) ) {
+                    bestValue = values[i];
+                    bestAction = a;
+                }
+            }
+        }
+#endif
+
+        inline size_t findBestA(const double * V, size_t A) {
+            size_t a = 1, bestAction = 0;
+            double bestValue = V[0];
+#ifdef __AVX2__
+            if ( A >= 8 ) {
+                __m256d best = _mm256_loadu_pd(V), bestIdx = _mm256_setr_pd(0, 1, 2, 3);
+                __m256d idx = _mm256_setr_pd(4, 5, 6, 7);
+                const __m256d four = _mm256_set1_pd(4);
+
+                for ( a = 4; a + 4 <= A; a += 4 ) {
+                    __m256d v = _mm256_loadu_pd(V + a);
+                    __m256d gt = _mm256_cmp_pd(v, best, _CMP_GT_OQ);
+                    best    = _mm256_blendv_pd(best, v, gt);
+                    bestIdx = _mm256_blendv_pd(bestIdx, idx, gt);
+                    idx = _mm256_add_pd(idx, four);
+                }
+                reduceBest(best, bestIdx, bestValue, bestAction);
+            }
+#endif
+            for ( ; a < A; ++a ) {
+                if ( V[a] > bestValue ) {
+                    bestValue = V[a];
+                    bestAction = a;
+                }
+            }
+            return bestAction;
+        }
+
+        inline size_t findBestBonusA(const double * V, const unsigned * N, size_t A, double logCount, double exploration) {
+            auto evaluationFunction = [&](size_t a) {
+                return V[a] + exploration * std::sqrt( logCount / N[a] );
+            };
+
+            size_t a = 1, bestAction = 0;
+            double bestValue = evaluationFunction(0);
+#ifdef __AVX2__
+            if ( A >= 8 ) {
+                const __m256d c = _mm256_set1_pd(exploration), l = _mm256_set1_pd(logCount), four = _mm256_set1_pd(4);
+                auto score = [&](size_t a) {
+                    __m256d v = _mm256_loadu_pd(V + a);
+                    __m256d n = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(N + a)));
+                    return _mm256_add_pd(v, _mm256_mul_pd(c, _mm256_sqrt_pd(_mm256_div_pd(l, n))));
+                };
+
+                __m256d best = score(0), bestIdx = _mm256_setr_pd(0, 1, 2, 3);
+                __m256d idx = _mm256_setr_pd(4, 5, 6, 7);
+
+                for ( a = 4; a + 4 <= A; a += 4 ) {
+                    __m256d s = score(a);
+                    __m256d gt = _mm256_cmp_pd(s, best, _CMP_GT_OQ);
+                    best    = _mm256_blendv_pd(best, s, gt);
+                    bestIdx = _mm256_blendv_pd(bestIdx, idx, gt);
+                    idx = _mm256_add_pd(idx, four);
+                }
+                reduceBest(best, bestIdx, bestValue, bestAction);
+            }
+#endif
+            for ( ; a < A; ++a ) {
+                double actionValue = evaluationFunction(a);
+                if ( actionValue > bestValue ) {
+                    bestValue = actionValue;
+                    bestAction = a;
+                }
+            }
+            return bestAction;
+        }
+
+        inline size_t findBestBonusA(const double * V, const unsigned * N, const unsigned * P, size_t A, double logCount, double exploration, double virtualLoss) {
+            auto evaluationFunction = [&](size_t a) {
+                unsigned n = N[a] + P[a];
+                return V[a] - virtualLoss * P[a] / ( n ? n : 1u ) + exploration * std::sqrt( logCount / n );
+            };
+
+            size_t a = 1, bestAction = 0;
+            double bestValue = evaluationFunction(0);
+#ifdef __AVX2__
+            if ( A >= 8 ) {
+                const __m256d c = _mm256_set1_pd(exploration), l = _mm256_set1_pd(logCount), vl = _mm256_set1_pd(virtualLoss);
+                const __m256d one = _mm256_set1_pd(1), four = _mm256_set1_pd(4);
+                auto score = [&](size_t a) {
+                    __m128i ni = _mm_loadu_si128(reinterpret_cast<const __m128i*>(N + a));
+                    __m128i pi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(P + a));
+                    __m256d v = _mm256_loadu_pd(V + a);
+                    __m256d p = _mm256_cvtepi32_pd(pi);
+                    __m256d n = _mm256_cvtepi32_pd(_mm_add_epi32(ni, pi));
+                    __m256d loss = _mm256_div_pd(_mm256_mul_pd(vl, p), _mm256_max_pd(n, one));
+                    return _mm256_add_pd(_mm256_sub_pd(v, loss), _mm256_mul_pd(c, _mm256_sqrt_pd(_mm256_div_pd(l, n))));
+                };
+
+                __m256d best = score(0), bestIdx = _mm256_setr_pd(0, 1, 2, 3);
+                __m256d idx = _mm256_setr_pd(4, 5, 6, 7);
+
+                for ( a = 4; a + 4 <= A; a += 4 ) {
+                    __m256d s = score(a);
+                    __m256d gt = _mm256_cmp_pd(s, best, _CMP_GT_OQ);
+                    best    = _mm256_blendv_pd(best, s, gt);
+                    bestIdx = _mm256_blendv_pd(bestIdx, idx, gt);
+                    idx = _mm256_add_pd(idx, four);
+                }
+                reduceBest(best, bestIdx, bestValue, bestAction);
+            }
+#endif
+            for ( ; a < A; ++a ) {
+                double actionValue = evaluationFunction(a);
+                if ( actionValue > bestValue ) {
+                    bestValue = actionValue;
+                    bestAction = a;
+                }
+            }
+            return bestAction;
+        }
+    }
+}
+
+#endif
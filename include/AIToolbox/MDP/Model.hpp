@@ -212,6 +212,22 @@ namespace AIToolbox {
                  */
                 std::tuple<size_t, double> sampleSR(size_t s, size_t a) const;
 
+                /**
+                 * @brief This function samples the MDP for the specified state action pair.
+                 *
+                 * This function works as the other sampleSR(), but it only
+                 * uses the provided generator, so that multiple threads can
+                 * sample the same model at the same time.
+                 *
+                 * @param s The state that needs to be sampled.
+                 * @param a The action that needs to be sampled.
+                 * @param rand The generator to sample with.
+                 *
+                 * @return A tuple containing a new state and a reward.
+                 */
+                template <typename G>
+                std::tuple<size_t, double> sampleSR(size_t s, size_t a, G & rand) const;
+
                 /**
                  * @brief This function returns the number of states of the world.
                  *
@@ -326,6 +342,13 @@ namespace AIToolbox {
         void Model::setRewardFunction( const R & r ) {
             copyTable3D(r, rewards_, S, A, S);
         }
+
+        template <typename G>
+        std::tuple<size_t, double> Model::sampleSR(size_t s, size_t a, G & rand) const {
+            size_t s1 = sampleProbability(S, transitions_[s][a], rand);
+
+            return std::make_tuple(s1, rewards_[s][a][s1]);
+        }
     } // MDP
 } // AIToolbox
 
@@ -3,10 +3,15 @@
 
 #include <AIToolbox/POMDP/Types.hpp>
 #include <AIToolbox/ProbabilityUtils.hpp>
-#include <AIToolbox/Impl/Seeder.hpp>
+#include <AIToolbox/Impl/UCB.hpp>
+#include <AIToolbox/Impl/ProgressiveWidening.hpp>
+#include <AIToolbox/PlannerStats.hpp>
+
+#include <MasterThesis/Random.hpp>
 
 #include <unordered_map>
 #include <iostream>
+#include <chrono>
 
 namespace AIToolbox {
     namespace POMDP {
@@ -74,17 +79,29 @@ namespace AIToolbox {
 
                 struct ActionNode {
                     BeliefNodes children;
-                    double V = 0.0;
-                    unsigned N = 0;
                 };
                 using ActionNodes = std::vector<ActionNode>;
 
+                // The statistics of the actions are kept in separate
+                // arrays, so that they can be scored quickly.
+                struct ActionStats {
+                    std::vector<double> V;
+                    std::vector<unsigned> N;
+                };
+
                 struct BeliefNode {
-                    BeliefNode() : N(0) {}
-                    BeliefNode(size_t s) : belief(1, s), N(0) {}
+                    BeliefNode() : N(0), descendants(0) {}
+                    BeliefNode(size_t s) : belief(1, s), N(0), descendants(0) {}
+                    void addActions(size_t A) {
+                        children.resize(A);
+                        stats.V.resize(A);
+                        stats.N.resize(A);
+                    }
                     ActionNodes children;
+                    ActionStats stats;
                     SampleBelief belief;
                     unsigned N;
+                    size_t descendants; // Number of nodes below this one.
                 };
 
                 /**
@@ -167,6 +184,23 @@ namespace AIToolbox {
                  */
                 void setExploration(double exp);
 
+                /**
+                 * @brief This function sets the progressive widening of the observations.
+                 *
+                 * An action tried N times can have at most max(1, k * N^alpha)
+                 * observation children. Once an action has as many as
+                 * allowed, samples with new observations are merged into the
+                 * child with the closest observation (see
+                 * Impl::closestObservation). This lets POMCP search deeper
+                 * when the observation space is large. For the same reason,
+                 * sampleAction(a, o, horizon) continues from the closest
+                 * child when the real observation has none.
+                 *
+                 * @param k The widening constant, 0 to disable widening.
+                 * @param alpha The widening exponent, in [0, 1].
+                 */
+                void setProgressiveWidening(double k, double alpha);
+
                 /**
                  * @brief This function returns the POMDP generative model being used.
                  *
@@ -202,40 +236,63 @@ namespace AIToolbox {
                  */
                 double getExploration() const;
 
+                /**
+                 * @brief This function returns the progressive widening constant.
+                 *
+                 * @return The widening constant, 0 if widening is disabled.
+                 */
+                double getWideningConstant() const;
+
+                /**
+                 * @brief This function returns the progressive widening exponent.
+                 *
+                 * @return The widening exponent.
+                 */
+                double getWideningExponent() const;
+
+                /**
+                 * @brief This function returns what the last sampleAction call did.
+                 *
+                 * POMCP allocates its nodes individually, so it does not
+                 * track the memory used by the tree and bytes is always zero.
+                 *
+                 * @return The statistics of the last call.
+                 */
+                const PlannerStats & getStats() const;
+
             private:
                 const M& model_;
                 size_t S, A, beliefSize_;
                 unsigned iterations_, maxDepth_;
-                double exploration_;
+                double exploration_, wideningK_, wideningAlpha_;
 
                 SampleBelief sampleBelief_;
                 BeliefNode graph_;
 
                 mutable std::default_random_engine rand_;
 
+                PlannerStats stats_;
+
                 // Private Methods
                 size_t runSimulation(unsigned horizon);
                 double simulate(BeliefNode & b, size_t s, unsigned horizon);
                 double rollout(size_t s, unsigned horizon);
 
-                template <typename Iterator>
-                Iterator findBestA(Iterator begin, Iterator end);
-
-                template <typename Iterator>
-                Iterator findBestBonusA(Iterator begin, Iterator end, unsigned count);
+                size_t findBestA(const BeliefNode & b);
+                size_t findBestBonusA(const BeliefNode & b);
 
                 SampleBelief makeSampledBelief(const Belief & b);
         };
 
         template <typename M>
         POMCP<M>::POMCP(const M& m, size_t beliefSize, unsigned iter, double exp) : model_(m), S(model_.getS()), A(model_.getA()), beliefSize_(beliefSize), iterations_(iter),
-                                                                              exploration_(exp), graph_(), rand_(Impl::Seeder::getSeed()) {}
+                                                                              exploration_(exp), wideningK_(0.0), wideningAlpha_(0.5), graph_(), rand_(RandomStreams::getSeed()) {}
 
         template <typename M>
         size_t POMCP<M>::sampleAction(const Belief& b, unsigned horizon) {
             // Reset graph
             graph_ = BeliefNode(A);
-            graph_.children.resize(A);
+            graph_.addActions(A);
             graph_.belief = makeSampledBelief(b);
 
             return runSimulation(horizon);
@@ -246,6 +303,10 @@ namespace AIToolbox {
             auto & obs = graph_.children[a].children;
 
             auto it = obs.find(o);
+            // With widening the observation may have been merged into the
+            // child of a close one, which we then continue from.
+            if ( it == obs.end() && wideningK_ > 0.0 && !obs.empty() )
+                it = Impl::closestObservation(obs, o);
             if ( it == obs.end() ) {
                 std::cerr << "Observation " << o << " never experienced in simulation, restarting with uniform belief..\n";
                 return sampleAction(Belief(S, 1.0 / S), horizon);
@@ -266,31 +327,39 @@ namespace AIToolbox {
             // We resize here in case we didn't have time to sample the new
             // head node. In this case, the new head may not have children.
             // This would break the UCT call.
-            graph_.children.resize(A);
+            graph_.addActions(A);
 
             return runSimulation(horizon);
         }
 
         template <typename M>
         size_t POMCP<M>::runSimulation(unsigned horizon) {
+            stats_.reset(horizon);
             if ( !horizon ) return 0;
 
             maxDepth_ = horizon;
             std::uniform_int_distribution<size_t> generator(0, graph_.belief.size()-1);
 
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+            const auto start = std::chrono::steady_clock::now();
+            stats_.nodesReused = graph_.descendants;
+#endif
+
             for (unsigned i = 0; i < iterations_; ++i )
                 simulate(graph_, graph_.belief.at(generator(rand_)), 0);
 
-            auto begin = std::begin(graph_.children);
-            return std::distance(begin, findBestA(begin, std::end(graph_.children)));
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+            stats_.simulations = iterations_;
+            stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#endif
+            return findBestA(graph_);
         }
 
         template <typename M>
         double POMCP<M>::simulate(BeliefNode & b, size_t s, unsigned depth) {
             b.N++;
 
-            auto begin = std::begin(b.children);
-            size_t a = std::distance(begin, findBestBonusA(begin, std::end(b.children), b.N));
+            size_t a = findBestBonusA(b);
 
             size_t s1, o; double rew;
             std::tie(s1, o, rew) = model_.sampleSOR(s, a);
@@ -302,10 +371,18 @@ namespace AIToolbox {
                 // We need to append the node anyway to perform the belief
                 // update for the next timestep.
                 auto ot = aNode.children.find(o);
+                // If the action cannot widen further, the sample goes to
+                // the closest observation we already have.
+                if ( ot == std::end(aNode.children) && !Impl::canWiden(aNode.children.size(), b.stats.N[a] + 1, wideningK_, wideningAlpha_) )
+                    ot = Impl::closestObservation(aNode.children, o);
+
                 if ( ot == std::end(aNode.children) ) {
                     aNode.children.emplace(std::piecewise_construct,
                                            std::forward_as_tuple(o),
                                            std::forward_as_tuple(s1));
+                    b.descendants += 1;
+                    stats_.recordNode(depth + 1, aNode.children.size() == 1);
+                    stats_.recordLeaf(depth + 1, depth + 1 >= maxDepth_);
                     // This stops automatically if we go out of depth
                     futureRew = rollout(s1, depth + 1);
                 }
@@ -318,17 +395,23 @@ namespace AIToolbox {
                         // we are actually descending into a node. If the node
                         // already has memory this should not do anything in
                         // any case.
-                        ot->second.children.resize(A);
+                        ot->second.addActions(A);
+                        // Nodes added below the child are also below us.
+                        const size_t descendants = ot->second.descendants;
                         futureRew = simulate( ot->second, s1, depth + 1 );
+                        b.descendants += ot->second.descendants - descendants;
                     }
+                    else
+                        stats_.recordLeaf(depth + 1, depth + 1 >= maxDepth_);
                 }
 
                 rew += model_.getDiscount() * futureRew;
             }
 
             // Action update
-            aNode.N++;
-            aNode.V += ( rew - aNode.V ) / static_cast<double>(aNode.N);
+            auto & stats = b.stats;
+            stats.N[a]++;
+            stats.V[a] += ( rew - stats.V[a] ) / static_cast<double>(stats.N[a]);
 
             return rew;
         }
@@ -348,35 +431,17 @@ namespace AIToolbox {
         }
 
         template <typename M>
-        template <typename Iterator>
-        Iterator POMCP<M>::findBestA(Iterator begin, Iterator end) {
-            return std::max_element(begin, end, [](const ActionNode & lhs, const ActionNode & rhs){ return lhs.V < rhs.V; });
+        size_t POMCP<M>::findBestA(const BeliefNode & b) {
+            return Impl::findBestA(b.stats.V.data(), A);
         }
 
         template <typename M>
-        template <typename Iterator>
-        Iterator POMCP<M>::findBestBonusA(Iterator begin, Iterator end, unsigned count) {
+        size_t POMCP<M>::findBestBonusA(const BeliefNode & b) {
             // Count here can be as low as 1.
             // Since log(1) = 0, and 0/0 = error, we add 1.0.
-            double logCount = std::log(count + 1.0);
-            // We use this function to produce a score for each action. This can be easily
-            // substituted with something else to produce different POMCP variants.
-            auto evaluationFunction = [this, logCount](const ActionNode & an){
-                    return an.V + exploration_ * std::sqrt( logCount / an.N );
-            };
-
-            auto bestIterator = begin++;
-            double bestValue = evaluationFunction(*bestIterator);
-
-            for ( ; begin < end; ++begin ) {
-                double actionValue = evaluationFunction(*begin);
-                if ( actionValue > bestValue ) {
-                    bestValue = actionValue;
-                    bestIterator = begin;
-                }
-            }
-
-            return bestIterator;
+            double logCount = std::log(b.N + 1.0);
+            // The score of each action is its value plus the UCB1 bonus.
+            return Impl::findBestBonusA(b.stats.V.data(), b.stats.N.data(), A, logCount, exploration_);
         }
 
         template <typename M>
@@ -405,6 +470,12 @@ namespace AIToolbox {
             exploration_ = exp;
         }
 
+        template <typename M>
+        void POMCP<M>::setProgressiveWidening(double k, double alpha) {
+            wideningK_ = k;
+            wideningAlpha_ = alpha;
+        }
+
         template <typename M>
         const M& POMCP<M>::getModel() const {
             return model_;
@@ -429,6 +500,21 @@ namespace AIToolbox {
         double POMCP<M>::getExploration() const {
             return exploration_;
         }
+
+        template <typename M>
+        double POMCP<M>::getWideningConstant() const {
+            return wideningK_;
+        }
+
+        template <typename M>
+        double POMCP<M>::getWideningExponent() const {
+            return wideningAlpha_;
+        }
+
+        template <typename M>
+        const PlannerStats & POMCP<M>::getStats() const {
+            return stats_;
+        }
     }
 }
 
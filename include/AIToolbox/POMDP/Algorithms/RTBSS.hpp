@@ -134,16 +134,19 @@ namespace AIToolbox {
             std::iota(std::begin(actionList), std::end(actionList), 0);
 
             double max = -std::numeric_limits<double>::infinity();
+            BeliefExpansion expansion;
 
             for ( auto a : actionList ) {
                 double rew = beliefExpectedReward(model_, b, a);
 
                 double uBound = rew + upperBound(b, a, horizon - 1);
                 if ( uBound > max ) {
-                    for ( size_t o = 0; o < O; ++o ) {
-                        double p = beliefObservationProbability(model_, b, a, o);
+                    // We compute all possible observations and beliefs at once.
+                    expandBelief(model_, b, a, expansion);
+                    for ( auto & entry : expansion ) {
+                        double p = std::get<1>(entry);
                         // Only work if it makes sense
-                        if ( checkDifferentSmall(p, 0.0) ) rew += model_.getDiscount() * p * simulate(updateBelief(model_, b, a, o), horizon - 1);
+                        if ( checkDifferentSmall(p, 0.0) ) rew += model_.getDiscount() * p * simulate(std::get<2>(entry), horizon - 1);
                     }
                 }
                 if ( rew > max ) {
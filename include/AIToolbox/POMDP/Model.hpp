@@ -178,6 +178,23 @@ namespace AIToolbox {
                  */
                 std::tuple<size_t,size_t, double> sampleSOR(size_t s,size_t a) const;
 
+                /**
+                 * @brief This function samples the POMDP for the specified state action pair.
+                 *
+                 * This function works as the other sampleSOR(), but it only
+                 * uses the provided generator, so that multiple threads can
+                 * sample the same model at the same time. The underlying MDP
+                 * model must provide an equivalent sampleSR() overload.
+                 *
+                 * @param s The state that needs to be sampled.
+                 * @param a The action that needs to be sampled.
+                 * @param rand The generator to sample with.
+                 *
+                 * @return A tuple containing a new state, observation and reward.
+                 */
+                template <typename G>
+                std::tuple<size_t,size_t, double> sampleSOR(size_t s,size_t a, G & rand) const;
+
                 /**
                  * @brief This function samples the POMDP for the specified state action pair.
                  *
@@ -196,6 +213,22 @@ namespace AIToolbox {
                  */
                 std::tuple<size_t, double> sampleOR(size_t s,size_t a,size_t s1) const;
 
+                /**
+                 * @brief This function samples the POMDP for the specified state action pair.
+                 *
+                 * This function works as the other sampleOR(), but it only
+                 * uses the provided generator.
+                 *
+                 * @param s The state that needs to be sampled.
+                 * @param a The action that needs to be sampled.
+                 * @param s1 The resulting state of the s,a transition.
+                 * @param rand The generator to sample with.
+                 *
+                 * @return A tuple containing a new observation and reward.
+                 */
+                template <typename G>
+                std::tuple<size_t, double> sampleOR(size_t s,size_t a,size_t s1, G & rand) const;
+
                 /**
                  * @brief This function returns the stored observation probability for the specified state-action pair.
                  *
@@ -310,12 +343,32 @@ namespace AIToolbox {
             return std::make_tuple(s1, o, r);
         }
 
+        template <typename M>
+        template <typename G>
+        std::tuple<size_t,size_t, double> Model<M>::sampleSOR(size_t s, size_t a, G & rand) const {
+            size_t s1, o;
+            double r;
+
+            std::tie(s1, r) = this->sampleSR(s, a, rand);
+            o = sampleProbability(O, observations_[s1][a], rand);
+
+            return std::make_tuple(s1, o, r);
+        }
+
         template <typename M>
         std::tuple<size_t, double> Model<M>::sampleOR(size_t s, size_t a, size_t s1) const {
             size_t o = sampleProbability(O, observations_[s1][a], rand_);
             double r = this->getExpectedReward(s, a, s1);
             return std::make_tuple(o, r);
         }
+
+        template <typename M>
+        template <typename G>
+        std::tuple<size_t, double> Model<M>::sampleOR(size_t s, size_t a, size_t s1, G & rand) const {
+            size_t o = sampleProbability(O, observations_[s1][a], rand);
+            double r = this->getExpectedReward(s, a, s1);
+            return std::make_tuple(o, r);
+        }
     }
 }
 
@@ -4,6 +4,9 @@
 #include <cstddef>
 #include <iterator>
 #include <numeric>
+#include <algorithm>
+#include <limits>
+#include <tuple>
 
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
@@ -49,7 +52,7 @@ namespace AIToolbox {
          */
         template <typename G>
         Belief makeRandomBelief(size_t S, G & generator) {
-            static std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
+            std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
             Belief b(S);
             for ( size_t s = 0; s < S; ++s )
                 b[s] = sampleDistribution(generator);
@@ -133,6 +136,71 @@ namespace AIToolbox {
             return p;
         }
 
+        /**
+         * @brief This type lists the observations which are possible after a belief and action.
+         *
+         * Each entry contains an observation, its probability, and the belief
+         * updated with it.
+         */
+        using BeliefExpansion = std::vector<std::tuple<size_t, double, Belief>>;
+
+        /**
+         * @brief This function computes all observations possible from a belief and action, with their probabilities and updated beliefs.
+         *
+         * This gives the same results as calling beliefObservationProbability
+         * and updateBelief for every observation, but the belief is only
+         * propagated through the transition function once, and each state
+         * reached is only visited once for all observations.
+         *
+         * Only observations with non-zero probability are listed, in
+         * increasing order.
+         *
+         * @param model The POMDP model to use.
+         * @param b The belief to start from.
+         * @param a The action performed.
+         * @param out The list of possible observations. Its previous contents are discarded.
+         */
+        template <typename M, typename = typename std::enable_if<is_model<M>::value>::type>
+        void expandBelief(const M & model, const Belief & b, size_t a, BeliefExpansion & out) {
+            size_t S = model.getS(), O = model.getO();
+
+            Belief predicted(S);
+            for ( size_t s1 = 0; s1 < S; ++s1 ) {
+                double sum = 0.0;
+                for ( size_t s = 0; s < S; ++s )
+                    sum += model.getTransitionProbability(s, a, s1) * b[s];
+
+                predicted[s1] = sum;
+            }
+
+            // Position in out of each observation, once we find it.
+            std::vector<size_t> index(O, std::numeric_limits<size_t>::max());
+            out.clear();
+            for ( size_t s1 = 0; s1 < S; ++s1 ) {
+                if ( predicted[s1] == 0.0 ) continue;
+                for ( size_t o = 0; o < O; ++o ) {
+                    double p = model.getObservationProbability(s1, a, o) * predicted[s1];
+                    if ( p == 0.0 ) continue;
+
+                    if ( index[o] == std::numeric_limits<size_t>::max() ) {
+                        index[o] = out.size();
+                        out.emplace_back(o, 0.0, Belief(S, 0.0));
+                    }
+                    auto & entry = out[index[o]];
+                    std::get<1>(entry) += p;
+                    std::get<2>(entry)[s1] = p;
+                }
+            }
+
+            std::sort(std::begin(out), std::end(out), [](const BeliefExpansion::value_type & lhs, const BeliefExpansion::value_type & rhs) {
+                return std::get<0>(lhs) < std::get<0>(rhs);
+            });
+            for ( auto & entry : out ) {
+                auto & br = std::get<2>(entry);
+                normalizeProbability(std::begin(br), std::end(br), std::begin(br));
+            }
+        }
+
         /**
          * @brief This function returns an iterator pointing to the best value for the specified belief.
          *
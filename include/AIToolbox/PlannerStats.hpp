@@ -0,0 +1,131 @@
+#ifndef AI_TOOLBOX_PLANNER_STATS_HEADER_FILE
+#define AI_TOOLBOX_PLANNER_STATS_HEADER_FILE
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace AIToolbox {
+    /**
+     * @brief This struct contains what a tree search planner did during its last sampleAction call.
+     *
+     * Planners only update a few counters while they search, so the
+     * statistics are cheap enough to always keep on. Compiling with
+     * AI_TOOLBOX_NO_PLANNER_STATS removes them entirely: all recording
+     * functions become empty, and the statistics always stay zero.
+     *
+     * When planning with multiple threads, each thread records its own
+     * statistics, which are merged at the end of the call.
+     */
+    struct PlannerStats {
+        unsigned simulations = 0;       ///< Number of simulations run.
+        double seconds = 0.0;           ///< Wall time of the call.
+        size_t nodesCreated = 0;        ///< Belief nodes added to the tree.
+        size_t nodesReused = 0;         ///< Belief nodes kept from the previous call when rerooting.
+        size_t bytes = 0;               ///< Memory used by the tree(s) at the end of the call, if the planner tracks it.
+
+        unsigned maxDepth = 0;          ///< Deepest tree node reached by a simulation.
+        size_t totalDepth = 0;          ///< Sum of the depths reached by each simulation.
+        unsigned leavesAtMaxDepth = 0;  ///< Simulations which reached the horizon within the tree.
+
+        // These are indexed by depth, where the root has depth 0. Branching
+        // is computed over the nodes created during the call.
+        std::vector<unsigned> nodesPerDepth;        ///< Belief nodes created at each depth.
+        std::vector<unsigned> actionsPerDepth;      ///< Actions which got their first child at each depth.
+
+        /**
+         * @brief This function clears the statistics for a new call.
+         *
+         * @param horizon The horizon of the call.
+         */
+        void reset(unsigned horizon) {
+            *this = PlannerStats();
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+            nodesPerDepth.resize(horizon + 1);
+            actionsPerDepth.resize(horizon + 1);
+#else
+            (void)horizon;
+#endif
+        }
+
+        /**
+         * @brief This function records the creation of a belief node.
+         *
+         * @param depth The depth of the new node.
+         * @param firstOfAction Whether the new node is the first child of its action.
+         */
+        void recordNode(unsigned depth, bool firstOfAction) {
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+            ++nodesCreated;
+            ++nodesPerDepth[depth];
+            actionsPerDepth[depth - 1] += firstOfAction;
+#else
+            (void)depth; (void)firstOfAction;
+#endif
+        }
+
+        /**
+         * @brief This function records the end of a simulation within the tree.
+         *
+         * @param depth The depth of the last node reached.
+         * @param atMaxDepth Whether the simulation reached the horizon.
+         */
+        void recordLeaf(unsigned depth, bool atMaxDepth) {
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+            maxDepth = std::max(maxDepth, depth);
+            totalDepth += depth;
+            leavesAtMaxDepth += atMaxDepth;
+#else
+            (void)depth; (void)atMaxDepth;
+#endif
+        }
+
+        /**
+         * @brief This function adds the statistics of another thread to these.
+         *
+         * Simulations are summed; the wall time is not, as threads run
+         * at the same time.
+         */
+        void merge(const PlannerStats & other) {
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+            simulations += other.simulations;
+            nodesCreated += other.nodesCreated;
+            maxDepth = std::max(maxDepth, other.maxDepth);
+            totalDepth += other.totalDepth;
+            leavesAtMaxDepth += other.leavesAtMaxDepth;
+            for ( size_t d = 0; d < std::min(nodesPerDepth.size(), other.nodesPerDepth.size()); ++d ) {
+                nodesPerDepth[d] += other.nodesPerDepth[d];
+                actionsPerDepth[d] += other.actionsPerDepth[d];
+            }
+#else
+            (void)other;
+#endif
+        }
+
+        double simulationsPerSecond() const {
+            return seconds > 0.0 ? simulations / seconds : 0.0;
+        }
+
+        double averageDepth() const {
+            return simulations ? static_cast<double>(totalDepth) / simulations : 0.0;
+        }
+
+        double maxDepthFraction() const {
+            return simulations ? static_cast<double>(leavesAtMaxDepth) / simulations : 0.0;
+        }
+
+        /**
+         * @brief This function returns the average number of observations seen after an action at the input depth.
+         *
+         * @param depth The depth of the node taking the action.
+         *
+         * @return The average number of children of the actions which got new children at that depth.
+         */
+        double branching(unsigned depth) const {
+            if ( depth + 1 >= nodesPerDepth.size() || !actionsPerDepth[depth] ) return 0.0;
+            return static_cast<double>(nodesPerDepth[depth + 1]) / actionsPerDepth[depth];
+        }
+    };
+}
+
+#endif
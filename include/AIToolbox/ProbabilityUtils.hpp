@@ -102,7 +102,7 @@ namespace AIToolbox {
      */
     template <typename T, typename G>
     size_t sampleProbability(size_t d, const T& in, G& generator) {
-        static std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
+        std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
         double p = sampleDistribution(generator);
 
         for ( size_t i = 0; i < d; ++i ) {
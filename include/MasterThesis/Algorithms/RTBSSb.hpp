@@ -5,15 +5,21 @@
 #include <AIToolbox/POMDP/Utils.hpp>
 #include <AIToolbox/ProbabilityUtils.hpp>
 
+#include <MasterThesis/Algorithms/Utils/KnowledgeMeasures.hpp>
+#include <MasterThesis/Algorithms/Utils/SparseBelief.hpp>
+#include <MasterThesis/Algorithms/Utils/ThreadPool.hpp>
+
 #include <limits>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 namespace ap = AIToolbox::POMDP;
 namespace a = AIToolbox;
 
 #ifndef DOXYGEN_SKIP
 // This is done to avoid bringing around the enable_if everywhere.
-template <typename M, typename = typename std::enable_if<ap::is_model<M>::value>::type>
+template <typename M, typename K = Entropy, typename = typename std::enable_if<ap::is_model<M>::value>::type>
 class RTBSSb;
 #endif
 
@@ -41,21 +47,34 @@ class RTBSSb;
  * belief.  Note that values computed in different methods may differ
  * due to floating point approximation errors.
  *
- * This class is different from RTBSS in that it takes a function that
- * computes reward directly from the beliefs encountered.
+ * This class is different from RTBSS in that it computes reward directly
+ * from the beliefs encountered, using a knowledge measure.
+ *
+ * With multiple threads, the subtrees of each top-level action and
+ * observation are searched in parallel, while each subtree is searched
+ * serially as usual. The best value found so far is shared, so that
+ * top-level actions can still be pruned as soon as any thread proves they
+ * cannot win. Action values are summed in the serial order, and the serial
+ * pruning is replayed over them at the end, so the returned action and value
+ * are always the same as the serial search. The model must allow its
+ * probability functions to be called concurrently.
+ *
+ * @tparam M The POMDP model to plan on.
+ * @tparam K The knowledge measure used as reward of the beliefs (see KnowledgeMeasures.hpp).
  */
-template <typename M>
-class RTBSSb<M> {
+template <typename M, typename K>
+class RTBSSb<M, K> {
     public:
-        using RewFun = std::function<double(const ap::Belief&)>;
+        using Knowledge = K;
 
         /**
          * @brief Basic constructor.
          *
          * @param m The POMDP model that POMCP will operate upon.
          * @param maxR The max reward obtainable in the model. This is used for the pruning heuristic.
+         * @param threads The number of threads searching the top-level subtrees.
          */
-        RTBSSb(const M& m, double maxR, RewFun rew);
+        RTBSSb(const M& m, double maxR = K::maxValue(), unsigned threads = 1);
 
         /**
          * @brief This function computes the best value for a given belief and its value.
@@ -81,13 +100,21 @@ class RTBSSb<M> {
          */
         size_t getGuess() const;
 
+        /**
+         * @brief This function returns the number of threads used to plan.
+         *
+         * @return The number of threads.
+         */
+        unsigned getThreads() const;
+
     private:
         const M& model_;
         size_t S, A, O;
         size_t maxA_, maxDepth_;
         double maxR_;
-        RewFun rewFun_;
         ap::Belief currentBelief_;
+        unsigned threads_;
+        std::unique_ptr<ThreadPool> pool_;
 
         /**
          * @brief This function performs the actual work of computing the best action and its value.
@@ -104,6 +131,35 @@ class RTBSSb<M> {
          */
         double simulate(const ap::Belief & b, unsigned horizon);
 
+        /**
+         * @brief This function computes the value of an action, searching all its subtrees.
+         *
+         * @param b The belief to plan for.
+         * @param a The action to evaluate.
+         * @param horizon The horizon to plan for. Must be greater than 0.
+         * @param expansion Storage for the observations possible after the action.
+         *
+         * @return The value of the action.
+         */
+        double evaluateAction(const ap::Belief & b, size_t a, unsigned horizon, ap::BeliefExpansion & expansion);
+
+        /**
+         * @brief This function computes the same as simulate, splitting the top-level subtrees between threads.
+         *
+         * Threads evaluate actions speculatively, only skipping those which
+         * an earlier action already proves pruned. The results are then
+         * replayed in order with the same pruning as simulate, evaluating
+         * any action which was skipped but turns out to be needed. This
+         * happens only if the upper bound is not respected, even by
+         * rounding, and guarantees the same result as simulate.
+         *
+         * @param b The belief to plan for.
+         * @param horizon The horizon to plan for. Must be greater than 0.
+         *
+         * @return The value of the best action.
+         */
+        double parallelSimulate(const ap::Belief & b, unsigned horizon);
+
         /**
          * @brief This function represents an heuristic to prune branches.
          *
@@ -125,21 +181,25 @@ class RTBSSb<M> {
         double upperBound(const ap::Belief & b, size_t a, unsigned horizon) const;
 };
 
-template <typename M>
-RTBSSb<M>::RTBSSb(const M& m, double maxR, RewFun r) : model_(m), S(model_.getS()), A(model_.getA()), O(model_.getO()), maxR_(maxR), rewFun_(r) {}
+template <typename M, typename K>
+RTBSSb<M, K>::RTBSSb(const M& m, double maxR, unsigned threads) : model_(m), S(model_.getS()), A(model_.getA()), O(model_.getO()), maxR_(maxR),
+                                                                   threads_(std::max(threads, 1u))
+{
+    if ( threads_ > 1 ) pool_.reset(new ThreadPool(threads_));
+}
 
-template <typename M>
-std::tuple<size_t, double> RTBSSb<M>::sampleAction(const ap::Belief& b, unsigned horizon) {
+template <typename M, typename K>
+std::tuple<size_t, double> RTBSSb<M, K>::sampleAction(const ap::Belief& b, unsigned horizon) {
     maxA_ = 0; maxDepth_ = horizon;
     currentBelief_ = b;
 
-    double value = simulate(b, horizon);
+    double value = ( pool_ && horizon ) ? parallelSimulate(b, horizon) : simulate(b, horizon);
 
     return std::make_tuple(maxA_, value);
 }
 
-template <typename M>
-double RTBSSb<M>::simulate(const ap::Belief & b, unsigned horizon) {
+template <typename M, typename K>
+double RTBSSb<M, K>::simulate(const ap::Belief & b, unsigned horizon) {
     if ( horizon == 0 ) return 0;
 
     std::vector<size_t> actionList(A);
@@ -149,43 +209,144 @@ double RTBSSb<M>::simulate(const ap::Belief & b, unsigned horizon) {
     std::iota(std::begin(actionList), std::end(actionList), 0);
 
     double max = -std::numeric_limits<double>::infinity();
+    ap::BeliefExpansion expansion;
 
     for ( auto a : actionList ) {
         double rew = 0.0;
 
         double uBound = upperBound(b, a, horizon);
-        if ( uBound > max ) {
-            for ( size_t o = 0; o < O; ++o ) {
-                double p = ap::beliefObservationProbability(model_, b, a, o);
-                // Only work if it makes sense
-                if ( a::checkEqualSmall(p, 0.0) ) continue;
-
-                auto b1 = ap::updateBelief(model_,b,a,o);
-                rew += model_.getDiscount() * p * simulate(b1, horizon - 1);
-                rew += p * rewFun_(b1);
+        if ( uBound > max ) rew = evaluateAction(b, a, horizon, expansion);
+        if ( rew > max ) {
+            max = rew;
+            if ( horizon == maxDepth_ ) maxA_ = a;
+        }
+    }
+    return max;
+}
+
+template <typename M, typename K>
+double RTBSSb<M, K>::evaluateAction(const ap::Belief & b, size_t a, unsigned horizon, ap::BeliefExpansion & expansion) {
+    double rew = 0.0;
+
+    // We compute all possible observations and beliefs at once.
+    sparseExpandBelief(model_, b, a, expansion);
+    for ( auto & entry : expansion ) {
+        double p = std::get<1>(entry);
+        // Only work if it makes sense
+        if ( a::checkEqualSmall(p, 0.0) ) continue;
+
+        auto & b1 = std::get<2>(entry);
+        rew += model_.getDiscount() * p * simulate(b1, horizon - 1);
+        rew += p * K::evaluate(b1);
+    }
+    return rew;
+}
+
+template <typename M, typename K>
+double RTBSSb<M, K>::parallelSimulate(const ap::Belief & b, unsigned horizon) {
+    std::vector<ap::BeliefExpansion> expansions(A);
+    pool_->parallelFor(A, [&](unsigned a) {
+        sparseExpandBelief(model_, b, a, expansions[a]);
+    });
+
+    // Each job is the subtree of an action and one of its observations. The
+    // jobs of each action are contiguous, and are handed out in order, so
+    // the first actions complete early and give a bound to prune the others.
+    std::vector<std::pair<size_t, size_t>> jobs;
+    std::vector<size_t> firstJob(A + 1);
+    for ( size_t a = 0; a < A; ++a ) {
+        firstJob[a] = jobs.size();
+        for ( size_t i = 0; i < expansions[a].size(); ++i )
+            if ( !a::checkEqualSmall(std::get<1>(expansions[a][i]), 0.0) )
+                jobs.emplace_back(a, i);
+    }
+    firstJob[A] = jobs.size();
+
+    // The two terms each job adds to its action value, kept apart so that
+    // they are summed exactly as in evaluateAction.
+    std::vector<std::pair<double, double>> terms(jobs.size());
+    std::vector<size_t> remaining(A);
+    std::vector<double> values(A, 0.0);
+    std::vector<char> evaluated(A, false), skipped(A, false);
+    for ( size_t a = 0; a < A; ++a ) {
+        remaining[a] = firstJob[a + 1] - firstJob[a];
+        // Without possible observations the value is zero.
+        evaluated[a] = !remaining[a];
+    }
+
+    std::mutex mutex;
+    // The best value found so far, and the first action reaching it.
+    double max = -std::numeric_limits<double>::infinity();
+    size_t maxA = A;
+
+    pool_->parallelFor(jobs.size(), [&](unsigned j) {
+        const size_t a = jobs[j].first;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // As in simulate, only earlier actions can prune this one.
+            if ( skipped[a] || ( maxA < a && !(upperBound(b, a, horizon) > max) ) ) {
+                skipped[a] = true;
+                return;
             }
         }
+
+        const auto & entry = expansions[a][jobs[j].second];
+        const double p = std::get<1>(entry);
+        const auto & b1 = std::get<2>(entry);
+        const double future = model_.getDiscount() * p * simulate(b1, horizon - 1);
+        const double now = p * K::evaluate(b1);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        terms[j] = std::make_pair(future, now);
+        if ( --remaining[a] || skipped[a] ) return;
+
+        double rew = 0.0;
+        for ( size_t i = firstJob[a]; i < firstJob[a + 1]; ++i ) {
+            rew += terms[i].first;
+            rew += terms[i].second;
+        }
+        values[a] = rew;
+        evaluated[a] = true;
+        if ( rew > max || ( rew == max && a < maxA ) ) {
+            max = rew;
+            maxA = a;
+        }
+    });
+
+    // We replay the serial search over the values we have.
+    max = -std::numeric_limits<double>::infinity();
+    ap::BeliefExpansion expansion;
+    for ( size_t a = 0; a < A; ++a ) {
+        double rew = 0.0;
+
+        double uBound = upperBound(b, a, horizon);
+        if ( uBound > max ) rew = evaluated[a] ? values[a] : evaluateAction(b, a, horizon, expansion);
         if ( rew > max ) {
             max = rew;
-            if ( horizon == maxDepth_ ) maxA_ = a;
+            maxA_ = a;
         }
     }
     return max;
 }
 
-template <typename M>
-double RTBSSb<M>::upperBound(const ap::Belief &, size_t, unsigned horizon) const {
+template <typename M, typename K>
+double RTBSSb<M, K>::upperBound(const ap::Belief &, size_t, unsigned horizon) const {
     return maxR_ + model_.getDiscount() * maxR_ * (horizon - 1);
 }
 
-template <typename M>
-const M& RTBSSb<M>::getModel() const {
+template <typename M, typename K>
+const M& RTBSSb<M, K>::getModel() const {
     return model_;
 }
 
-template <typename M>
-size_t RTBSSb<M>::getGuess() const {
+template <typename M, typename K>
+size_t RTBSSb<M, K>::getGuess() const {
     return std::distance(std::begin(currentBelief_), std::max_element(std::begin(currentBelief_), std::end(currentBelief_)));
 }
 
+template <typename M, typename K>
+unsigned RTBSSb<M, K>::getThreads() const {
+    return threads_;
+}
+
 #endif
@@ -0,0 +1,134 @@
+#ifndef MASTER_THESIS_ARENA_HEADER_FILE
+#define MASTER_THESIS_ARENA_HEADER_FILE
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <new>
+
+#include <MasterThesis/Algorithms/Utils/NodeLock.hpp>
+
+// This is a simple block allocator which owns all the nodes of a search tree
+// and their containers. Memory is carved out of large blocks, and small
+// chunks which are given back are kept in free lists to be reused (this
+// happens a lot as hash tables and vectors grow).
+//
+// The main point of the arena is that a whole tree can be thrown away at
+// once with release(), without visiting it. Objects living in the arena
+// are never destroyed, so they must not own anything outside of it.
+//
+// A single arena can be shared by threads searching the same tree. So that
+// they do not contend for it, the arena is split in lanes, each with its own
+// current block, free lists and lock, and each thread allocates from the
+// lane it selected with Arena::Lane. Chunks can be given back to any lane,
+// so containers can still be grown by any thread. Only new blocks are taken
+// under a lock shared by all lanes.
+class Arena {
+    public:
+        // This selects the lane the current thread allocates from, until it
+        // goes out of scope. Arenas with fewer lanes use their first one,
+        // which is also the default.
+        class Lane {
+            public:
+                Lane(unsigned lane);
+                ~Lane();
+
+                Lane(const Lane &) = delete;
+                Lane & operator=(const Lane &) = delete;
+
+            private:
+                unsigned previous_;
+        };
+
+        Arena(unsigned lanes = 1, size_t blockSize = 1 << 20);
+        ~Arena();
+
+        Arena(const Arena &) = delete;
+        Arena & operator=(const Arena &) = delete;
+
+        void * allocate(size_t bytes);
+        void deallocate(void * p, size_t bytes);
+
+        // This constructs an object in the arena. It won't ever be destroyed.
+        template <typename T, typename... Args>
+        T * make(Args&&... args) {
+            return new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // This drops everything allocated in the arena at once. Only the
+        // first block is kept to be reused.
+        void release();
+
+        // Bytes handed out and not given back yet.
+        size_t bytesInUse() const;
+        // Bytes requested from the system.
+        size_t bytesReserved() const;
+
+        // Bytes taken by a chunk allocated with the input size.
+        static size_t chunkSize(size_t bytes) {
+            return bytes ? ( bytes + Align - 1 ) / Align * Align : Align;
+        }
+
+        // Bytes taken by a copy of the input vector.
+        template <typename V>
+        static size_t vectorBytes(const V & v) {
+            return v.empty() ? 0 : chunkSize(v.size() * sizeof(typename V::value_type));
+        }
+
+    private:
+        enum : size_t { Align = alignof(std::max_align_t), SmallClasses = 16, MaxSmall = SmallClasses * Align };
+
+        struct FreeChunk { FreeChunk * next; };
+
+        // Lanes are padded so that threads do not write to the same cache lines.
+        struct LaneState {
+            char * head = nullptr, * end = nullptr;
+            FreeChunk * free[SmallClasses] = {};
+            size_t inUse = 0; // Chunks given back to another lane make this wrap, but the sum is right.
+            NodeLock lock;
+            char padding[64];
+        };
+
+        LaneState & getLane();
+        char * newBlock(size_t bytes);
+
+        static thread_local unsigned currentLane_;
+
+        size_t blockSize_;
+        std::vector<LaneState> lanes_;
+        std::vector<std::pair<char *, size_t>> blocks_;
+        size_t reserved_;
+        NodeLock blocksLock_;
+};
+
+// This is a standard allocator which takes its memory from an Arena, so it
+// can be used with all standard containers. Containers copied with it keep
+// allocating from the same arena.
+template <typename T>
+class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        ArenaAllocator(Arena & arena) : arena_(&arena) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> & other) : arena_(&other.getArena()) {}
+
+        T * allocate(size_t n) {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Arena does not support over-aligned types");
+            return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+        }
+        void deallocate(T * p, size_t n) { arena_->deallocate(p, n * sizeof(T)); }
+
+        Arena & getArena() const { return *arena_; }
+
+    private:
+        Arena * arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> & lhs, const ArenaAllocator<U> & rhs) { return &lhs.getArena() == &rhs.getArena(); }
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> & lhs, const ArenaAllocator<U> & rhs) { return !(lhs == rhs); }
+
+#endif
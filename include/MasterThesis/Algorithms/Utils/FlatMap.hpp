@@ -0,0 +1,121 @@
+#ifndef MASTER_THESIS_FLAT_MAP_HEADER_FILE
+#define MASTER_THESIS_FLAT_MAP_HEADER_FILE
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include <MasterThesis/Algorithms/Utils/Arena.hpp>
+
+// This is a small map from indeces (states, observations) to values, used
+// within tree nodes.
+//
+// Values are kept in a flat vector in insertion order. As long as there are
+// at most LinearLimit of them we just search it linearly; after that we
+// build an open-addressing index on top of it, so that each access is a
+// single probe in a small table of integers.
+//
+// Values are moved when the map grows, so references to them are not stable.
+template <typename V, size_t LinearLimit>
+class FlatMap {
+    public:
+        using value_type = std::pair<size_t, V>;
+        using allocator_type = ArenaAllocator<value_type>;
+        using Entries = std::vector<value_type, allocator_type>;
+        using const_iterator = typename Entries::const_iterator;
+
+        FlatMap(Arena & arena) : entries_(arena), index_(arena), shift_(0) {}
+
+        // This copies the map in a new arena. Values are copied as they are.
+        FlatMap(const FlatMap & other, Arena & arena) : entries_(other.entries_.begin(), other.entries_.end(), arena),
+                                                        index_(other.index_.begin(), other.index_.end(), arena), shift_(other.shift_) {}
+
+        // This returns the value for the input key, value-initializing it if needed.
+        V & operator[](size_t key) {
+            if ( index_.empty() ) {
+                for ( auto & pair : entries_ )
+                    if ( pair.first == key ) return pair.second;
+
+                entries_.emplace_back(key, V());
+                if ( entries_.size() > LinearLimit ) rehash(4 * LinearLimit);
+                return entries_.back().second;
+            }
+
+            size_t mask = index_.size() - 1;
+            for ( size_t i = bucket(key); ; i = ( i + 1 ) & mask ) {
+                uint32_t pos = index_[i];
+                if ( !pos ) {
+                    entries_.emplace_back(key, V());
+                    index_[i] = entries_.size();
+                    // We keep the load under one half, so probes stay short.
+                    if ( 2 * entries_.size() > index_.size() ) rehash(2 * index_.size());
+                    return entries_.back().second;
+                }
+                if ( entries_[pos - 1].first == key ) return entries_[pos - 1].second;
+            }
+        }
+
+        // This returns the value for the input key, or nullptr if it is not there.
+        const V * find(size_t key) const {
+            if ( index_.empty() ) {
+                for ( auto & pair : entries_ )
+                    if ( pair.first == key ) return &pair.second;
+                return nullptr;
+            }
+
+            size_t mask = index_.size() - 1;
+            for ( size_t i = bucket(key); index_[i]; i = ( i + 1 ) & mask )
+                if ( entries_[index_[i] - 1].first == key ) return &entries_[index_[i] - 1].second;
+            return nullptr;
+        }
+
+        void reserve(size_t size) { entries_.reserve(size); }
+        size_t size() const { return entries_.size(); }
+        bool empty() const { return entries_.empty(); }
+        const_iterator begin() const { return entries_.begin(); }
+        const_iterator end() const { return entries_.end(); }
+
+        allocator_type get_allocator() const { return entries_.get_allocator(); }
+
+        // This returns the bytes a copy of the map takes in its arena.
+        size_t getCopyBytes() const {
+            size_t bytes = 0;
+            if ( !entries_.empty() ) bytes += Arena::chunkSize(entries_.size() * sizeof(value_type));
+            if ( !index_.empty() )   bytes += Arena::chunkSize(index_.size() * sizeof(uint32_t));
+            return bytes;
+        }
+
+        // This removes all values and gives their memory back.
+        void clear() {
+            Entries(entries_.get_allocator()).swap(entries_);
+            decltype(index_)(index_.get_allocator()).swap(index_);
+            shift_ = 0;
+        }
+
+    private:
+        size_t bucket(size_t key) const {
+            // Fibonacci hashing: keys are often contiguous, and this spreads
+            // them over the whole table.
+            return static_cast<size_t>( ( static_cast<uint64_t>(key) * 11400714819323198485ull ) >> shift_ );
+        }
+
+        void rehash(size_t buckets) {
+            index_.assign(buckets, 0);
+            shift_ = 64;
+            while ( buckets > 1 ) { buckets >>= 1; --shift_; }
+
+            size_t mask = index_.size() - 1;
+            for ( size_t pos = 0; pos < entries_.size(); ++pos ) {
+                size_t i = bucket(entries_[pos].first);
+                while ( index_[i] ) i = ( i + 1 ) & mask;
+                index_[i] = pos + 1;
+            }
+        }
+
+        Entries entries_;
+        std::vector<uint32_t, ArenaAllocator<uint32_t>> index_; // Positions in entries_ plus one, 0 is empty.
+        unsigned shift_;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef MASTER_THESIS_JOINT_TREE_NODES_HEADER_FILE
+#define MASTER_THESIS_JOINT_TREE_NODES_HEADER_FILE
+
+#include <vector>
+
+#include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
+
+// These are the nodes of the tree used to track multiple targets at once
+// (see MultiTarget in Targets.hpp). The actions are shared by all targets,
+// while each belief node keeps a separate particle belief and knowledge
+// measure for each of them. Children of action nodes are indexed by a key
+// identifying the observations of all targets.
+//
+// They work as the nodes in TreeNodes.hpp, so that the same search core can
+// use either of them.
+
+template <typename K>
+struct JointActionNode;
+template <typename K>
+using JointActionNodes = std::vector<JointActionNode<K>, ArenaAllocator<JointActionNode<K>>>;
+
+template <typename K>
+class JointBeliefNode {
+    public:
+        JointBeliefNode(size_t targets, Arena & arena);
+        // This copies the whole subtree of the input node into the arena,
+        // collapsing nodes visited less than minN times (see BeliefNode).
+        JointBeliefNode(const JointBeliefNode & other, Arena & arena, unsigned minN = 0, NodeCopies<JointBeliefNode> * copies = nullptr);
+
+        // This function creates the action nodes, if they are not there yet.
+        void addActions(size_t A);
+
+        // This function adds a particle for each target, and updates their knowledge measures.
+        void updateBeliefAndKnowledge(const std::vector<size_t> & states) {
+            for ( size_t t = 0; t < states.size(); ++t )
+                K::update(knowledge_[t], trackBeliefs_[t][states[t]], N);
+        }
+
+        // This function returns the sum of the knowledge measures of all targets.
+        double getKnowledgeMeasure() const {
+            double sum = 0.0;
+            for ( auto & k : knowledge_ )
+                sum += K::value(k);
+            return sum;
+        }
+
+        size_t getTargets() const { return trackBeliefs_.size(); }
+        const TrackBelief<K> & getTrackBelief(size_t target) const { return trackBeliefs_[target]; }
+
+        // These return the bytes a copy of this node takes in an arena (see BeliefNode).
+        size_t getLeafBytes() const;
+        size_t getActionsBytes() const;
+
+        unsigned N;          // Counter for number of times we went through this belief node.
+        JointActionNodes<K> children;
+        ActionStats stats;   // Statistics of each action in children.
+        NodeLock lock;       // Protects this node, its actions and their children when searching in parallel.
+
+        double V;            // Estimated value for this belief, taking into account future rewards/actions.
+        double actionsV;     // Estimated value for the actions (could be mean, max, or other)
+        size_t bestAction;   // Tracker of best available action in MAX-mode, to select node value.
+        bool maxMode;        // Whether actionsV has switched from the mean to MAX-mode.
+
+    protected:
+        std::vector<TrackBelief<K>, ArenaAllocator<TrackBelief<K>>> trackBeliefs_;                    // One particle belief per target.
+        std::vector<typename K::Knowledge, ArenaAllocator<typename K::Knowledge>> knowledge_;       // One knowledge measure per target.
+};
+
+template <typename K>
+using JointBeliefNodes = FlatMap<JointBeliefNode<K> *, 8>;
+
+template <typename K>
+struct JointActionNode {
+    JointActionNode(Arena & arena);
+    JointActionNode(const JointActionNode & other, Arena & arena, unsigned minN = 0, NodeCopies<JointBeliefNode<K>> * copies = nullptr);
+
+    JointBeliefNodes<K> children;
+};
+
+// This is the top of the tree, which keeps the particles of each target in
+// a form which is fast to sample (see HeadBeliefNode). Targets are assumed
+// to move and be observed independently, so each is sampled on its own.
+template <typename K>
+class JointHeadBeliefNode : public JointBeliefNode<K> {
+    public:
+        // Particles as state-count pairs, one map per target.
+        using Particles = std::vector<RootParticles::Particles>;
+
+        JointHeadBeliefNode(size_t targets, size_t A, Arena & arena);
+        // All targets start from the same belief.
+        JointHeadBeliefNode(size_t targets, size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, Arena & arena, RandomEngine & rand);
+        JointHeadBeliefNode(size_t A, const JointBeliefNode<K> & bn, Arena & arena, RandomEngine & rand, NodeCopies<JointBeliefNode<K>> * copies = nullptr);
+        // This creates an empty tree which samples from the same particles as the input one.
+        JointHeadBeliefNode(size_t A, const JointHeadBeliefNode & particles, Arena & arena, RandomEngine & rand);
+        // This copies the whole tree, collapsing nodes visited less than minN times (see BeliefNode).
+        JointHeadBeliefNode(const JointHeadBeliefNode & other, Arena & arena, unsigned minN, NodeCopies<JointBeliefNode<K>> * copies = nullptr);
+
+        // This adds the input particles to the ones of each target.
+        void addParticles(const Particles & particles);
+        // This samples beliefSize particles from the belief for each target
+        // which has none, and returns how many targets were refilled.
+        unsigned refill(size_t beliefSize, const AIToolbox::POMDP::Belief & b, RandomEngine & rand);
+
+        bool isSampleBeliefEmpty(size_t target) const;
+        const SampleBelief & getSampleBelief(size_t target) const { return particles_[target].getParticles(); }
+        // This samples a state for each target.
+        void sampleBelief(std::vector<size_t> & states, RandomEngine & rand) const;
+        size_t sampleBelief(size_t target, RandomEngine & rand) const;
+        size_t getMostCommonParticle(size_t target) const;
+
+        unsigned visits;     // Visits since this node became the root, while N also counts the ones it had as a child.
+
+    private:
+        std::vector<RootParticles, ArenaAllocator<RootParticles>> particles_; // One set of particles per target.
+};
+
+extern template class JointBeliefNode<Entropy>;
+extern template struct JointActionNode<Entropy>;
+extern template class JointHeadBeliefNode<Entropy>;
+
+extern template class JointBeliefNode<MaxBelief>;
+extern template struct JointActionNode<MaxBelief>;
+extern template class JointHeadBeliefNode<MaxBelief>;
+
+#endif
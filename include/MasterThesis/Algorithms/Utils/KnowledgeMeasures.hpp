@@ -0,0 +1,92 @@
+#ifndef MASTER_THESIS_KNOWLEDGE_MEASURES_HEADER_FILE
+#define MASTER_THESIS_KNOWLEDGE_MEASURES_HEADER_FILE
+
+#include <cmath>
+#include <algorithm>
+
+#include <AIToolbox/ProbabilityUtils.hpp>
+#include <AIToolbox/POMDP/Types.hpp>
+
+// These are the knowledge measures which the planners can use as reward for
+// a belief. Each is a policy, passed as template parameter to the tree nodes
+// and the planners, and provides:
+//
+// - Particle: what a belief node stores for each distinct state it has seen.
+// - Knowledge: what a belief node stores to keep the measure up to date.
+// - update(knowledge, particle, N): adds a particle to a belief node which
+//   contained N of them, and updates the measure.
+// - value(knowledge): the current value of the measure.
+// - evaluate(b): the measure of a full belief.
+// - maxValue(): the highest value the measure can take.
+// - name(): a name to print in the experiment logs.
+
+// Negative entropy of the belief.
+struct Entropy {
+    struct Particle {
+        unsigned N = 0;             // Number of particles for this particular type (state)
+        double negativeEntropy = 0; // Estimated entropy deriving from this particle type
+    };
+
+    struct Knowledge {
+        double value = 0.0;
+    };
+
+    // In theory this is wrong as we should update all the entropy terms, one
+    // for each different type of particle. In practice we hope this will work
+    // anyway, and that there are not going to be huge problems, as each particle
+    // should be seen enough times to still keep a decent approximation of its
+    // entropy term. Minor errors are ok since this is still an estimation.
+    static void update(Knowledge & k, Particle & particle, unsigned N) {
+        // Remove entropy term for this state from summatory
+        k.value -= particle.negativeEntropy;
+        // Updating belief
+        particle.N += 1;
+        // Computing new entropy term for this state
+        double p = static_cast<double>(particle.N) / static_cast<double>(N+1);
+        double newEntropy = p * std::log(p);
+        // Update values
+        particle.negativeEntropy = newEntropy;
+        k.value += newEntropy;
+    }
+
+    static double value(const Knowledge & k) { return k.value; }
+
+    static double evaluate(const AIToolbox::POMDP::Belief & b) {
+        double e = 0.0;
+        for ( auto v : b )
+            if ( AIToolbox::checkDifferentSmall(v, 0.0) ) e += v * std::log(v);
+        return e;
+    }
+
+    static double maxValue() { return 0.0; }
+    static const char * name() { return "ENTROPY"; }
+};
+
+// Probability of the most likely state of the belief.
+struct MaxBelief {
+    struct Particle {
+        unsigned N = 0;             // Number of particles for this particular type (state)
+    };
+
+    struct Knowledge {
+        double value = 0.0;
+        unsigned maxN = 0;          // This keeps track of the belief peak count
+    };
+
+    static void update(Knowledge & k, Particle & particle, unsigned N) {
+        particle.N += 1;
+        k.maxN = std::max(k.maxN, particle.N);
+        k.value = static_cast<double>(k.maxN) / static_cast<double>(N+1);
+    }
+
+    static double value(const Knowledge & k) { return k.value; }
+
+    static double evaluate(const AIToolbox::POMDP::Belief & b) {
+        return *std::max_element(std::begin(b), std::end(b));
+    }
+
+    static double maxValue() { return 1.0; }
+    static const char * name() { return "MAX OF BELIEF"; }
+};
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef MASTER_THESIS_LEAF_EVALUATORS_HEADER_FILE
+#define MASTER_THESIS_LEAF_EVALUATORS_HEADER_FILE
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#include <MasterThesis/Algorithms/Utils/ModelTraits.hpp>
+#include <MasterThesis/Algorithms/Utils/KnowledgeMeasures.hpp>
+#include <MasterThesis/Algorithms/Utils/ParticleFilter.hpp>
+#include <MasterThesis/Random.hpp>
+
+// These are the leaf evaluators which rPOMCP can use to estimate the value
+// of the nodes it creates, which are not searched further in the simulation
+// that created them. Each is passed as template parameter to the planner,
+// and is called as:
+//
+//     double operator()(const M & model, const LeafParticles<K> & parent, size_t s, unsigned depth, unsigned maxDepth, RandomEngine & rand) const
+//
+// where parent holds the particles of the node the new leaf was reached
+// from, s the state of the simulation in the leaf, and depth the depth of
+// the leaf. When the tree tracks multiple targets (see Targets.hpp), parent
+// is a JointLeafParticles<K> and s holds the state of each target.
+//
+// The particles are a copy, so that the planner can call the evaluator
+// without holding the locks of any node. The call must only use the input
+// generator, as it can be done by multiple threads at the same time. Leaves
+// at the maximum depth are not evaluated, as they simply take the value of
+// their knowledge measure.
+
+// These are the particles of the parent of a new leaf, for a single target
+// or one set per target. K is the knowledge measure of the tree.
+template <typename K>
+struct LeafParticles {
+    ParticleCounts particles;
+};
+
+template <typename K>
+struct JointLeafParticles {
+    std::vector<ParticleCounts> particles;
+};
+
+// This gives all leaves the same value. With the default 0 new nodes are
+// not evaluated at all.
+struct FixedHeuristic {
+    double value = 0.0;
+
+    template <typename M, typename B, typename S>
+    double operator()(const M &, const B &, const S &, unsigned, unsigned, RandomEngine &) const {
+        return value;
+    }
+};
+
+// This tells the planner whether the evaluator reads the particles of the
+// parent, so that it copies them only if needed.
+template <typename E>
+struct uses_leaf_particles : std::true_type {};
+
+template <>
+struct uses_leaf_particles<FixedHeuristic> : std::false_type {};
+
+// This performs a random rollout until the maximum depth or a terminal
+// state, and accumulates the discounted knowledge measure at each step, as
+// a full search would. A few particles go along with the simulation: at each
+// step they take the same random action, are weighted by the observation the
+// simulation produced (or kept only if they produce it, when the model is
+// only generative), and are resampled, so that their knowledge estimates the
+// one of the beliefs the rollout goes through.
+//
+// Since a new leaf only contains a single particle, its own knowledge is
+// meaningless, so the particles start from the ones of its parent, and their
+// knowledge is used for the leaf. If the parent has no particles, they
+// start from the leaf state.
+//
+// The particles are few, so their knowledge is computed as the nodes do,
+// adding them one at a time, without ever building a full belief.
+//
+// With multiple targets each has its own particles, all targets take the
+// same actions, and the knowledge of each step is summed over them. The
+// rollout then stops when all targets are in a terminal state.
+struct RandomRollout {
+    unsigned particles = 16;
+
+    template <typename M, typename K>
+    double operator()(const M & model, const LeafParticles<K> & parent, size_t s, unsigned depth, unsigned maxDepth, RandomEngine & rand) const {
+        std::uniform_int_distribution<size_t> actions(0, model.getA() - 1);
+
+        Filter<K> f;
+        startParticles(parent.particles, s, std::max(particles, 1u), f.states, rand);
+
+        double value = knowledge(f), discount = 1.0;
+        for ( ; depth < maxDepth && !model.isTerminal(s); ++depth ) {
+            size_t a = actions(rand);
+            step(model, f, s, a, rand);
+            discount *= model.getDiscount();
+            value += discount * knowledge(f);
+        }
+        return value;
+    }
+
+    template <typename M, typename K>
+    double operator()(const M & model, const JointLeafParticles<K> & parent, const std::vector<size_t> & s, unsigned depth, unsigned maxDepth, RandomEngine & rand) const {
+        std::uniform_int_distribution<size_t> actions(0, model.getA() - 1);
+        const size_t T = s.size();
+
+        std::vector<size_t> states(s);
+        std::vector<Filter<K>> filters(T);
+        double value = 0.0, discount = 1.0;
+        for ( size_t t = 0; t < T; ++t ) {
+            startParticles(parent.particles[t], s[t], std::max(particles, 1u), filters[t].states, rand);
+            value += knowledge(filters[t]);
+        }
+
+        auto allTerminal = [&]{
+            for ( auto st : states )
+                if ( !model.isTerminal(st) ) return false;
+            return true;
+        };
+
+        for ( ; depth < maxDepth && !allTerminal(); ++depth ) {
+            size_t a = actions(rand);
+            discount *= model.getDiscount();
+            for ( size_t t = 0; t < T; ++t ) {
+                step(model, filters[t], states[t], a, rand);
+                value += discount * knowledge(filters[t]);
+            }
+        }
+        return value;
+    }
+
+    private:
+        // The particles following the simulation of a single target.
+        template <typename K>
+        struct Filter {
+            std::vector<size_t> states;
+            std::vector<std::pair<size_t, double>> candidates;
+            std::vector<std::pair<size_t, typename K::Particle>> belief; // The distinct states, to compute the knowledge.
+        };
+
+        // This moves the simulation state s and the particles of f with
+        // action a.
+        template <typename M, typename K>
+        static void step(const M & model, Filter<K> & f, size_t & s, size_t a, RandomEngine & rand) {
+            size_t o;
+            std::tie(s, o, std::ignore) = ::sampleSOR(model, s, a, rand);
+
+            // The state of the simulation is always a candidate, so that
+            // the particles cannot all be lost.
+            double totalWeight = observationWeight(model, s, a, o, o);
+            f.candidates.assign(1, std::make_pair(s, totalWeight));
+            for ( auto p : f.states ) {
+                size_t p1, sampledO;
+                std::tie(p1, sampledO, std::ignore) = ::sampleSOR(model, p, a, rand);
+
+                double w = observationWeight(model, p1, a, o, sampledO);
+                if ( w <= 0.0 ) continue;
+
+                f.candidates.emplace_back(p1, w);
+                totalWeight += w;
+            }
+            const unsigned n = f.states.size();
+            f.states.clear();
+            resampleParticles(f.candidates, totalWeight, n, [&f](size_t p) { f.states.push_back(p); }, rand);
+        }
+
+        // This returns the knowledge measure of the particles of f.
+        template <typename K>
+        static double knowledge(Filter<K> & f) {
+            typename K::Knowledge k;
+            f.belief.clear();
+            for ( unsigned i = 0; i < f.states.size(); ++i ) {
+                auto it = std::find_if(f.belief.begin(), f.belief.end(), [&](const std::pair<size_t, typename K::Particle> & pair) {
+                    return pair.first == f.states[i];
+                });
+                if ( it == f.belief.end() ) it = f.belief.emplace(f.belief.end(), f.states[i], typename K::Particle());
+                K::update(k, it->second, i);
+            }
+            return K::value(k);
+        }
+
+        static void startParticles(const ParticleCounts & parent, size_t s, unsigned n, std::vector<size_t> & states, RandomEngine & rand) {
+            unsigned total = 0;
+            for ( auto & pair : parent ) total += pair.second;
+
+            states.clear();
+            if ( !total ) states.assign(n, s);
+            else resampleParticles(parent, total, n, [&states](size_t p) { states.push_back(p); }, rand);
+        }
+};
+
+// This allows to use any function as evaluator.
+template <typename M, typename K>
+using LeafFunction = std::function<double(const M &, const LeafParticles<K> &, size_t, unsigned, unsigned, RandomEngine &)>;
+
+#endif
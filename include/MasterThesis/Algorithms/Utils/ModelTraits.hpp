@@ -0,0 +1,110 @@
+#ifndef MASTER_THESIS_MODEL_TRAITS_HEADER_FILE
+#define MASTER_THESIS_MODEL_TRAITS_HEADER_FILE
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+#include <random>
+#include <type_traits>
+
+#include <MasterThesis/Random.hpp>
+
+/**
+ * @brief This struct represents the interface for a generative model which can be sampled concurrently.
+ *
+ * A model satisfies this interface if, on top of the normal generative
+ * interface, it implements:
+ *
+ * - std::tuple<size_t, size_t, double> sampleSOR(size_t s, size_t a, RandomEngine & rand) const
+ *
+ * which must sample exclusively using the provided generator, without
+ * touching any mutable state in the model. This allows multiple threads to
+ * sample the same model at the same time, each with its own generator.
+ *
+ * @tparam M The class to test for the interface.
+ */
+template <typename M>
+struct is_reentrant_generative_model {
+    private:
+        template <typename Z> static auto test(int) -> decltype(
+
+                static_cast<std::tuple<size_t,size_t,double> (Z::*)(size_t,size_t,RandomEngine&) const>(&Z::sampleSOR),
+
+                std::true_type()
+        );
+
+        template <typename Z> static auto test(...) -> std::false_type;
+
+    public:
+        enum { value = std::is_same<decltype(test<M>(0)),std::true_type>::value };
+};
+
+// These functions sample the model with the provided generator if it
+// supports it, and fall back to the model's own generator otherwise.
+template <typename M>
+std::tuple<size_t, size_t, double> sampleSOR(const M & model, size_t s, size_t a, RandomEngine & rand, std::true_type) {
+    return model.sampleSOR(s, a, rand);
+}
+
+template <typename M>
+std::tuple<size_t, size_t, double> sampleSOR(const M & model, size_t s, size_t a, RandomEngine &, std::false_type) {
+    return model.sampleSOR(s, a);
+}
+
+template <typename M>
+std::tuple<size_t, size_t, double> sampleSOR(const M & model, size_t s, size_t a, RandomEngine & rand) {
+    return sampleSOR(model, s, a, rand, std::integral_constant<bool, is_reentrant_generative_model<M>::value>());
+}
+
+/**
+ * @brief This struct represents the interface for a generative model which can be sampled in batches.
+ *
+ * A model satisfies this interface if it implements:
+ *
+ * - void sampleSORBatch(const std::vector<size_t> & states, const std::vector<size_t> & actions, std::vector<std::tuple<size_t, size_t, double>> & out, RandomEngine & rand) const
+ *
+ * which must resize out to the size of states, and fill it with the result
+ * of sampling each state-action pair. As for the reentrant interface, it
+ * must sample exclusively using the provided generator. Sampling many pairs
+ * at once allows the model to share work between them.
+ *
+ * @tparam M The class to test for the interface.
+ */
+template <typename M>
+struct is_batch_generative_model {
+    private:
+        using Samples = std::vector<std::tuple<size_t,size_t,double>>;
+
+        template <typename Z> static auto test(int) -> decltype(
+
+                static_cast<void (Z::*)(const std::vector<size_t>&,const std::vector<size_t>&,Samples&,RandomEngine&) const>(&Z::sampleSORBatch),
+
+                std::true_type()
+        );
+
+        template <typename Z> static auto test(...) -> std::false_type;
+
+    public:
+        enum { value = std::is_same<decltype(test<M>(0)),std::true_type>::value };
+};
+
+// These functions sample a batch of state-action pairs in a single call if
+// the model supports it, and one pair at a time otherwise.
+template <typename M>
+void sampleSORBatch(const M & model, const std::vector<size_t> & states, const std::vector<size_t> & actions, std::vector<std::tuple<size_t, size_t, double>> & out, RandomEngine & rand, std::true_type) {
+    model.sampleSORBatch(states, actions, out, rand);
+}
+
+template <typename M>
+void sampleSORBatch(const M & model, const std::vector<size_t> & states, const std::vector<size_t> & actions, std::vector<std::tuple<size_t, size_t, double>> & out, RandomEngine & rand, std::false_type) {
+    out.resize(states.size());
+    for ( size_t i = 0; i < states.size(); ++i )
+        out[i] = sampleSOR(model, states[i], actions[i], rand);
+}
+
+template <typename M>
+void sampleSORBatch(const M & model, const std::vector<size_t> & states, const std::vector<size_t> & actions, std::vector<std::tuple<size_t, size_t, double>> & out, RandomEngine & rand) {
+    sampleSORBatch(model, states, actions, out, rand, std::integral_constant<bool, is_batch_generative_model<M>::value>());
+}
+
+#endif
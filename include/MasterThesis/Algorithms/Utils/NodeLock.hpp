@@ -0,0 +1,33 @@
+#ifndef MASTER_THESIS_NODE_LOCK_HEADER_FILE
+#define MASTER_THESIS_NODE_LOCK_HEADER_FILE
+
+#include <atomic>
+#include <thread>
+
+// This is a very small spinlock, used to protect nodes when multiple threads
+// search the same tree. Copying or moving a lock produces a new unlocked
+// lock, so that nodes can still be moved around when nobody is searching.
+class NodeLock {
+    public:
+        NodeLock() {}
+        NodeLock(const NodeLock &) {}
+        NodeLock & operator=(const NodeLock &) { return *this; }
+
+        void lock() {
+            while ( flag_.test_and_set(std::memory_order_acquire) )
+                std::this_thread::yield();
+        }
+        void unlock() { flag_.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+// This can be used in place of a lock guard when nodes need no protection.
+struct NullGuard {
+    NullGuard(NodeLock &) {}
+    void lock() {}
+    void unlock() {}
+};
+
+#endif
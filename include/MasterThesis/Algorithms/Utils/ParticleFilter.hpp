@@ -0,0 +1,84 @@
+#ifndef MASTER_THESIS_PARTICLE_FILTER_HEADER_FILE
+#define MASTER_THESIS_PARTICLE_FILTER_HEADER_FILE
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+#include <random>
+#include <utility>
+#include <unordered_map>
+#include <type_traits>
+
+#include <AIToolbox/POMDP/Types.hpp>
+
+#include <MasterThesis/Algorithms/Utils/ModelTraits.hpp>
+#include <MasterThesis/Random.hpp>
+
+// These are the steps of the particle filters used by rPOMCP, both to
+// reinvigorate the root when rerooting, and in the rollouts of RandomRollout.
+
+// Particles as state-count pairs.
+using ParticleCounts = std::vector<std::pair<size_t, unsigned>>;
+
+// These return how much a step sampled by the model agrees with an
+// observation: its probability when the model has an observation function,
+// and otherwise whether the model sampled that observation itself.
+template <typename M>
+double observationWeight(const M & model, size_t s1, size_t a, size_t o, size_t, std::true_type) {
+    return model.getObservationProbability(s1, a, o);
+}
+
+template <typename M>
+double observationWeight(const M &, size_t, size_t, size_t o, size_t sampledO, std::false_type) {
+    return o == sampledO;
+}
+
+template <typename M>
+double observationWeight(const M & model, size_t s1, size_t a, size_t o, size_t sampledO) {
+    return observationWeight(model, s1, a, o, sampledO, std::integral_constant<bool, AIToolbox::POMDP::is_model<M>::value>());
+}
+
+// This resamples the weighted candidates, state-weight pairs, systematically
+// into n particles, calling add with the state of each of them.
+template <typename C, typename F>
+void resampleParticles(const C & candidates, double totalWeight, unsigned n, F add, RandomEngine & rand) {
+    const double step = totalWeight / n;
+    double pick = std::uniform_real_distribution<double>(0.0, step)(rand);
+    double cumulative = candidates[0].second;
+    size_t c = 0;
+    for ( unsigned i = 0; i < n; ++i, pick += step ) {
+        while ( pick > cumulative && c + 1 < candidates.size() )
+            cumulative += candidates[++c].second;
+        add(candidates[c].first);
+    }
+}
+
+// This is a simple particle filter step. Particles returned by sample() are
+// propagated through the model and weighted by the observation, and the
+// candidates are then resampled into n particles, which are added to the
+// input ones. Nothing is added if no candidate agrees with the observation.
+template <typename M, typename F>
+void reinvigorateParticles(const M & model, F sample, size_t a, size_t o, unsigned n, std::unordered_map<size_t, unsigned> & particles, RandomEngine & rand) {
+    // Maximum candidates tried for each particle.
+    const unsigned tries = 20;
+
+    std::vector<std::pair<size_t, double>> candidates;
+    candidates.reserve(n);
+
+    double totalWeight = 0.0;
+    for ( unsigned i = 0; i < n * tries && candidates.size() < n; ++i ) {
+        size_t s1, sampledO;
+        std::tie(s1, sampledO, std::ignore) = ::sampleSOR(model, sample(), a, rand);
+
+        double w = observationWeight(model, s1, a, o, sampledO);
+        if ( w <= 0.0 ) continue;
+
+        candidates.emplace_back(s1, w);
+        totalWeight += w;
+    }
+    if ( candidates.empty() ) return;
+
+    resampleParticles(candidates, totalWeight, n, [&particles](size_t s) { particles[s] += 1; }, rand);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef MASTER_THESIS_ROOT_SELECTION_HEADER_FILE
+#define MASTER_THESIS_ROOT_SELECTION_HEADER_FILE
+
+#include <cstddef>
+
+// These are the policies which the rPOMCP search core can use to select the
+// action to try at the root of the tree. Each provides:
+//
+// - select(root, A, bestBonusA): returns the action to try, where root has
+//   already counted the current visit, and bestBonusA() returns the action
+//   UCB1 would pick. It is only called when needed, as it is not free. The
+//   root is a head belief node, whose visits only count the ones it had
+//   since it became the root.
+
+// The root is searched as any other node.
+struct UCBRoot {
+    template <typename B, typename F>
+    static size_t select(const B &, size_t, F bestBonusA) {
+        return bestBonusA();
+    }
+};
+
+// All root actions are tried the same number of times, so as to evaluate
+// all of them equally precisely. A new root starts again from the first
+// action, so that each round covers all actions.
+struct RoundRobinRoot {
+    template <typename B, typename F>
+    static size_t select(const B & root, size_t A, F) {
+        return ( root.visits - 1 ) % A;
+    }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef MASTER_THESIS_SPARSE_BELIEF_HEADER_FILE
+#define MASTER_THESIS_SPARSE_BELIEF_HEADER_FILE
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include <AIToolbox/ProbabilityUtils.hpp>
+#include <AIToolbox/POMDP/Types.hpp>
+#include <AIToolbox/POMDP/Utils.hpp>
+
+// A list of states or observations, with their probabilities.
+using Outcomes = std::vector<std::pair<size_t, double>>;
+
+/**
+ * @brief This struct represents the interface for a model which can list its non-zero probabilities.
+ *
+ * A model satisfies this interface if it implements:
+ *
+ * - void getSuccessors(size_t s, size_t a, Outcomes & out) const
+ * - void getObservations(size_t s1, size_t a, Outcomes & out) const
+ *
+ * which must replace the contents of out with every state (respectively
+ * observation) which has non-zero probability after s and a (respectively
+ * after a and landing in s1), each listed once with the probability
+ * returned by getTransitionProbability (respectively
+ * getObservationProbability). This allows belief updates to only touch the
+ * few successors of each state, rather than all pairs of states.
+ *
+ * @tparam M The class to test for the interface.
+ */
+template <typename M>
+struct is_sparse_model {
+    private:
+        template <typename Z> static auto test(int) -> decltype(
+
+                static_cast<void (Z::*)(size_t,size_t,Outcomes&) const>(&Z::getSuccessors),
+                static_cast<void (Z::*)(size_t,size_t,Outcomes&) const>(&Z::getObservations),
+
+                std::true_type()
+        );
+
+        template <typename Z> static auto test(...) -> std::false_type;
+
+    public:
+        enum { value = std::is_same<decltype(test<M>(0)),std::true_type>::value };
+};
+
+/**
+ * @brief This function computes the belief after an action, before observing anything.
+ *
+ * @param model The sparse model to use.
+ * @param b The belief to start from.
+ * @param a The action performed.
+ * @param out The belief over the next states; it is resized to the number of states.
+ */
+template <typename M>
+void predictBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, AIToolbox::POMDP::Belief & out) {
+    const size_t S = model.getS();
+    out.assign(S, 0.0);
+
+    Outcomes successors;
+    for ( size_t s = 0; s < S; ++s ) {
+        if ( b[s] == 0.0 ) continue;
+        model.getSuccessors(s, a, successors);
+        for ( auto & succ : successors )
+            out[succ.first] += succ.second * b[s];
+    }
+}
+
+// These are the sparse versions of the belief functions below.
+template <typename M>
+AIToolbox::POMDP::Belief sparseUpdateBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, size_t o, std::true_type) {
+    AIToolbox::POMDP::Belief br;
+    predictBelief(model, b, a, br);
+
+    for ( size_t s1 = 0; s1 < br.size(); ++s1 )
+        if ( br[s1] != 0.0 ) br[s1] *= model.getObservationProbability(s1, a, o);
+
+    AIToolbox::normalizeProbability(std::begin(br), std::end(br), std::begin(br));
+
+    return br;
+}
+
+template <typename M>
+double sparseBeliefObservationProbability(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, size_t o, std::true_type) {
+    AIToolbox::POMDP::Belief br;
+    predictBelief(model, b, a, br);
+
+    double p = 0.0;
+    for ( size_t s1 = 0; s1 < br.size(); ++s1 )
+        if ( br[s1] != 0.0 ) p += model.getObservationProbability(s1, a, o) * br[s1];
+
+    return p;
+}
+
+template <typename M>
+void sparseExpandBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, AIToolbox::POMDP::BeliefExpansion & out, std::true_type) {
+    const size_t S = model.getS();
+    AIToolbox::POMDP::Belief predicted;
+    predictBelief(model, b, a, predicted);
+
+    // Position in out of each observation, once we find it.
+    std::vector<size_t> index(model.getO(), std::numeric_limits<size_t>::max());
+    out.clear();
+
+    Outcomes observations;
+    for ( size_t s1 = 0; s1 < S; ++s1 ) {
+        if ( predicted[s1] == 0.0 ) continue;
+        model.getObservations(s1, a, observations);
+        for ( auto & obs : observations ) {
+            double p = obs.second * predicted[s1];
+            if ( p == 0.0 ) continue;
+
+            if ( index[obs.first] == std::numeric_limits<size_t>::max() ) {
+                index[obs.first] = out.size();
+                out.emplace_back(obs.first, 0.0, AIToolbox::POMDP::Belief(S, 0.0));
+            }
+            auto & entry = out[index[obs.first]];
+            std::get<1>(entry) += p;
+            std::get<2>(entry)[s1] = p;
+        }
+    }
+
+    std::sort(std::begin(out), std::end(out), [](const AIToolbox::POMDP::BeliefExpansion::value_type & lhs, const AIToolbox::POMDP::BeliefExpansion::value_type & rhs) {
+        return std::get<0>(lhs) < std::get<0>(rhs);
+    });
+    for ( auto & entry : out ) {
+        auto & br = std::get<2>(entry);
+        AIToolbox::normalizeProbability(std::begin(br), std::end(br), std::begin(br));
+    }
+}
+
+// Models without the sparse interface use the AIToolbox functions.
+template <typename M>
+AIToolbox::POMDP::Belief sparseUpdateBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, size_t o, std::false_type) {
+    return AIToolbox::POMDP::updateBelief(model, b, a, o);
+}
+
+template <typename M>
+double sparseBeliefObservationProbability(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, size_t o, std::false_type) {
+    return AIToolbox::POMDP::beliefObservationProbability(model, b, a, o);
+}
+
+template <typename M>
+void sparseExpandBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, AIToolbox::POMDP::BeliefExpansion & out, std::false_type) {
+    AIToolbox::POMDP::expandBelief(model, b, a, out);
+}
+
+/**
+ * @brief This function updates a belief as AIToolbox::POMDP::updateBelief, using a sparse model if possible.
+ *
+ * If the model satisfies is_sparse_model, each state in the belief only
+ * visits its successors, so the update costs O(S * successors) rather than
+ * O(S^2). As states are visited in the same order, the result is the same
+ * as the dense version. Other models fall back to the dense version.
+ *
+ * @param model The model used to update the belief.
+ * @param b The old belief.
+ * @param a The action taken during the transition.
+ * @param o The observation registered.
+ *
+ * @return The updated belief.
+ */
+template <typename M>
+AIToolbox::POMDP::Belief sparseUpdateBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, size_t o) {
+    return sparseUpdateBelief(model, b, a, o, std::integral_constant<bool, is_sparse_model<M>::value>());
+}
+
+/**
+ * @brief This function computes the probability of an observation as AIToolbox::POMDP::beliefObservationProbability, using a sparse model if possible.
+ *
+ * @param model The model to use.
+ * @param b The belief to start from.
+ * @param a The action performed.
+ * @param o The observation that should be received.
+ *
+ * @return The probability of getting the observation from that belief and action.
+ */
+template <typename M>
+double sparseBeliefObservationProbability(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, size_t o) {
+    return sparseBeliefObservationProbability(model, b, a, o, std::integral_constant<bool, is_sparse_model<M>::value>());
+}
+
+/**
+ * @brief This function computes all observations possible from a belief and action as AIToolbox::POMDP::expandBelief, using a sparse model if possible.
+ *
+ * The belief is propagated once through the successors of its states, and
+ * then each reached state only visits its possible observations.
+ *
+ * @param model The model to use.
+ * @param b The belief to start from.
+ * @param a The action performed.
+ * @param out The list of possible observations, with their probabilities and updated beliefs.
+ */
+template <typename M>
+void sparseExpandBelief(const M & model, const AIToolbox::POMDP::Belief & b, size_t a, AIToolbox::POMDP::BeliefExpansion & out) {
+    sparseExpandBelief(model, b, a, out, std::integral_constant<bool, is_sparse_model<M>::value>());
+}
+
+#endif
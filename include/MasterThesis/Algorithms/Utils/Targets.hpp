@@ -0,0 +1,435 @@
+#ifndef MASTER_THESIS_TARGETS_HEADER_FILE
+#define MASTER_THESIS_TARGETS_HEADER_FILE
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include <limits>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <AIToolbox/POMDP/Types.hpp>
+
+#include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
+#include <MasterThesis/Algorithms/Utils/JointTreeNodes.hpp>
+#include <MasterThesis/Algorithms/Utils/ModelTraits.hpp>
+#include <MasterThesis/Algorithms/Utils/ParticleFilter.hpp>
+#include <MasterThesis/Algorithms/Utils/LeafEvaluators.hpp>
+#include <MasterThesis/Algorithms/Utils/NodeLock.hpp>
+#include <MasterThesis/Random.hpp>
+
+// These are the policies which the rPOMCP search core can use to decide
+// what its tree tracks: a single target, or many targets at once. Each
+// provides:
+//
+// - BeliefNode<K> and HeadBeliefNode<K>: the node types of the tree.
+// - State: the state of a simulation, and Observation: the real
+//   observation given to the planner when rerooting.
+// - getTargets(): the number of targets.
+// - makeNode<K>(arena), makeRoot<K>(A, arena, rand) and
+//   makeRoot<K>(A, beliefSize, b, arena, rand): new nodes in the arena.
+// - Keys: what a tree needs to number its observations, if anything.
+//   makeKeys(arena) returns the one of a new tree, allocated in its arena,
+//   and rekey(from, to) the function giving the new keys of the children
+//   copied between two trees (see NodeCopies), empty if they do not change.
+// - makeState(): a state to simulate with, filled by
+//   sampleState(root, s, rand).
+// - step(model, s, a, keys, rand): moves s in place, and returns the key of
+//   the sampled observation, which indexes the children of the action nodes.
+// - stepBatch(model, states, active, actions, keys, observations, buffers,
+//   rand): the same for the active states of a batch, with a single
+//   sampleSORBatch.
+// - isTerminal(model, s).
+// - key(o, keys): the key of a real observation, and distance(k1, k2,
+//   keys): how far the observations of two keys are, for progressive
+//   widening.
+// - reinvigorate(model, root, a, o, n, particles, rand): up to n new
+//   particles for each target, generated from the root and consistent with
+//   the action and observation (see reinvigorateParticles()).
+// - LeafParticles<K>, and copyParticles(b, depth, particles): the copy of
+//   the particles of a node given to the leaf evaluators (see
+//   LeafEvaluators.hpp). The root, at depth 0, keeps them apart from its
+//   track belief.
+//
+// Keys are exact: different observations never share a key. The keys of
+// a tree are only meaningful in that tree.
+
+// Buffers used to sample many steps with a single call to sampleSORBatch.
+struct StepBuffers {
+    std::vector<size_t> states, actions;
+    std::vector<std::tuple<size_t, size_t, double>> samples;
+};
+
+// The tree tracks a single target, and observations are their own keys.
+struct SingleTarget {
+    template <typename K> using BeliefNode = ::BeliefNode<K>;
+    template <typename K> using HeadBeliefNode = ::HeadBeliefNode<K>;
+    template <typename K> using LeafParticles = ::LeafParticles<K>;
+    using State = size_t;
+    using Observation = size_t;
+    struct Keys {};
+
+    size_t getTargets() const { return 1; }
+
+    Keys * makeKeys(Arena &) const { return nullptr; }
+    std::function<size_t(size_t)> rekey(const Keys *, Keys *) const { return nullptr; }
+
+    template <typename K>
+    BeliefNode<K> * makeNode(Arena & arena) const {
+        return arena.template make<BeliefNode<K>>(arena);
+    }
+
+    template <typename K>
+    HeadBeliefNode<K> * makeRoot(size_t A, Arena & arena, RandomEngine & rand) const {
+        return arena.template make<HeadBeliefNode<K>>(A, arena, rand);
+    }
+
+    template <typename K>
+    HeadBeliefNode<K> * makeRoot(size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, Arena & arena, RandomEngine & rand) const {
+        return arena.template make<HeadBeliefNode<K>>(A, beliefSize, b, arena, rand);
+    }
+
+    State makeState() const { return 0; }
+
+    template <typename K>
+    void sampleState(const HeadBeliefNode<K> & root, State & s, RandomEngine & rand) const {
+        s = root.sampleBelief(rand);
+    }
+
+    template <typename M>
+    size_t step(const M & model, State & s, size_t a, Keys *, RandomEngine & rand) const {
+        size_t o;
+        std::tie(s, o, std::ignore) = ::sampleSOR(model, s, a, rand);
+        return o;
+    }
+
+    template <typename M>
+    void stepBatch(const M & model, std::vector<State> & states, const std::vector<unsigned> & active, const std::vector<size_t> & actions, Keys *, std::vector<size_t> & observations, StepBuffers & buffers, RandomEngine & rand) const {
+        buffers.states.clear();
+        for ( auto i : active )
+            buffers.states.push_back(states[i]);
+
+        ::sampleSORBatch(model, buffers.states, actions, buffers.samples, rand);
+
+        observations.resize(active.size());
+        for ( size_t j = 0; j < active.size(); ++j )
+            std::tie(states[active[j]], observations[j], std::ignore) = buffers.samples[j];
+    }
+
+    template <typename M>
+    bool isTerminal(const M & model, const State & s) const {
+        return model.isTerminal(s);
+    }
+
+    size_t key(const Observation & o, Keys *) const { return o; }
+
+    size_t distance(size_t k1, size_t k2, Keys *) const {
+        return k1 > k2 ? k1 - k2 : k2 - k1;
+    }
+
+    template <typename M, typename K>
+    void reinvigorate(const M & model, const HeadBeliefNode<K> & root, size_t a, const Observation & o, unsigned n, typename HeadBeliefNode<K>::Particles & particles, RandomEngine & rand) const {
+        if ( root.isSampleBeliefEmpty() ) return;
+        reinvigorateParticles(model, [&]{ return root.sampleBelief(rand); }, a, o, n, particles, rand);
+    }
+
+    template <typename K>
+    void copyParticles(const BeliefNode<K> & b, unsigned depth, LeafParticles<K> & particles) const {
+        if ( depth == 0 ) {
+            const auto & root = static_cast<const HeadBeliefNode<K> &>(b).getSampleBelief();
+            particles.particles.assign(root.begin(), root.end());
+            return;
+        }
+        particles.particles.clear();
+        for ( auto & pair : b.getTrackBelief() )
+            particles.particles.emplace_back(pair.first, pair.second.N);
+    }
+};
+
+// The tree tracks many targets at once, which share the actions and are
+// moved and observed independently. States and observations hold one entry
+// per target, and the reward of the nodes is the sum of the knowledge
+// measures of all targets.
+//
+// When all joint observations can be numbered in 64 bits (O^T of them),
+// their key is that number. Otherwise each tree numbers the joint
+// observations in the order it first sees them, in Keys.
+class MultiTarget {
+    public:
+        template <typename K> using BeliefNode = JointBeliefNode<K>;
+        template <typename K> using HeadBeliefNode = JointHeadBeliefNode<K>;
+        template <typename K> using LeafParticles = JointLeafParticles<K>;
+        using State = std::vector<size_t>;
+        using Observation = std::vector<size_t>;
+
+        // The joint observations numbered by a tree. It lives in the arena
+        // of the tree, so that it is counted and dropped with it; copying
+        // the tree numbers again only the observations the copy still uses.
+        // Observations are split in shards by their hash, each with its own
+        // lock, so that the threads searching a tree rarely wait on each
+        // other.
+        class Keys {
+            public:
+                Keys(size_t targets, Arena & arena);
+
+                // This returns the key of the observation, numbering it if it is new.
+                size_t intern(const size_t * o);
+                // This returns the observation of a key. No thread may be
+                // interning new ones meanwhile.
+                const size_t * observation(size_t key) const;
+                // This returns the sum of the differences of the
+                // observations of each target.
+                size_t distance(size_t k1, size_t k2);
+
+            private:
+                enum : size_t { Shards = 16 };
+                struct Shard {
+                    Shard(Arena & arena) : observations(arena), index(arena) {}
+
+                    std::vector<size_t, ArenaAllocator<size_t>> observations; // One per target for each key.
+                    std::vector<uint32_t, ArenaAllocator<uint32_t>> index;    // Open addressing on the hash, 0 when empty and the key + 1 otherwise.
+                    NodeLock lock;
+                };
+
+                uint64_t hash(const size_t * o) const;
+                void grow(Shard & shard);
+
+                size_t T_;
+                std::vector<Shard, ArenaAllocator<Shard>> shards_;
+        };
+
+        /**
+         * @brief Basic constructor.
+         *
+         * @param model The model of a single target.
+         * @param targets The number of targets to track.
+         */
+        template <typename M>
+        MultiTarget(const M & model, size_t targets);
+
+        size_t getTargets() const { return T_; }
+
+        Keys * makeKeys(Arena & arena) const {
+            return exact_ ? nullptr : arena.make<Keys>(T_, arena);
+        }
+
+        std::function<size_t(size_t)> rekey(const Keys * from, Keys * to) const {
+            if ( exact_ ) return nullptr;
+            return [from, to](size_t k) { return to->intern(from->observation(k)); };
+        }
+
+        template <typename K>
+        BeliefNode<K> * makeNode(Arena & arena) const {
+            return arena.template make<BeliefNode<K>>(T_, arena);
+        }
+
+        template <typename K>
+        HeadBeliefNode<K> * makeRoot(size_t A, Arena & arena, RandomEngine &) const {
+            return arena.template make<HeadBeliefNode<K>>(T_, A, arena);
+        }
+
+        template <typename K>
+        HeadBeliefNode<K> * makeRoot(size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, Arena & arena, RandomEngine & rand) const {
+            return arena.template make<HeadBeliefNode<K>>(T_, A, beliefSize, b, arena, rand);
+        }
+
+        State makeState() const { return State(T_); }
+
+        template <typename K>
+        void sampleState(const HeadBeliefNode<K> & root, State & s, RandomEngine & rand) const {
+            root.sampleBelief(s, rand);
+        }
+
+        template <typename M>
+        size_t step(const M & model, State & s, size_t a, Keys * keys, RandomEngine & rand) const {
+            return combine(keys, [&](size_t t) {
+                size_t o;
+                std::tie(s[t], o, std::ignore) = ::sampleSOR(model, s[t], a, rand);
+                return o;
+            });
+        }
+
+        template <typename M>
+        void stepBatch(const M & model, std::vector<State> & states, const std::vector<unsigned> & active, const std::vector<size_t> & actions, Keys * keys, std::vector<size_t> & observations, StepBuffers & buffers, RandomEngine & rand) const {
+            buffers.states.clear();
+            buffers.actions.clear();
+            for ( size_t j = 0; j < active.size(); ++j ) {
+                for ( auto s : states[active[j]] ) {
+                    buffers.states.push_back(s);
+                    buffers.actions.push_back(actions[j]);
+                }
+            }
+
+            ::sampleSORBatch(model, buffers.states, buffers.actions, buffers.samples, rand);
+
+            observations.resize(active.size());
+            for ( size_t j = 0; j < active.size(); ++j ) {
+                auto & s = states[active[j]];
+                const auto * samples = &buffers.samples[j * T_];
+                observations[j] = combine(keys, [&](size_t t) {
+                    size_t o;
+                    std::tie(s[t], o, std::ignore) = samples[t];
+                    return o;
+                });
+            }
+        }
+
+        template <typename M>
+        bool isTerminal(const M & model, const State & s) const {
+            for ( auto st : s )
+                if ( !model.isTerminal(st) ) return false;
+            return true;
+        }
+
+        size_t key(const Observation & o, Keys * keys) const;
+        size_t distance(size_t k1, size_t k2, Keys * keys) const;
+
+        template <typename M, typename K>
+        void reinvigorate(const M & model, const HeadBeliefNode<K> & root, size_t a, const Observation & o, unsigned n, typename HeadBeliefNode<K>::Particles & particles, RandomEngine & rand) const {
+            particles.resize(T_);
+            for ( size_t t = 0; t < T_; ++t ) {
+                if ( root.isSampleBeliefEmpty(t) ) continue;
+                reinvigorateParticles(model, [&]{ return root.sampleBelief(t, rand); }, a, o[t], n, particles[t], rand);
+            }
+        }
+
+        template <typename K>
+        void copyParticles(const BeliefNode<K> & b, unsigned depth, LeafParticles<K> & particles) const {
+            particles.particles.resize(T_);
+            for ( size_t t = 0; t < T_; ++t ) {
+                auto & copy = particles.particles[t];
+                if ( depth == 0 ) {
+                    const auto & root = static_cast<const HeadBeliefNode<K> &>(b).getSampleBelief(t);
+                    copy.assign(root.begin(), root.end());
+                    continue;
+                }
+                copy.clear();
+                for ( auto & pair : b.getTrackBelief(t) )
+                    copy.emplace_back(pair.first, pair.second.N);
+            }
+        }
+
+    private:
+        // This returns the key of the observations of all targets, where
+        // observation(t) returns the one of target t; they are asked in order.
+        template <typename F>
+        size_t combine(Keys * keys, F observation) const;
+
+        size_t T_, O_;
+        bool exact_;
+};
+
+template <typename M>
+MultiTarget::MultiTarget(const M & model, size_t targets) : T_(targets), O_(model.getO()), exact_(true) {
+    if ( !T_ ) throw std::invalid_argument("MultiTarget needs at least one target");
+
+    size_t keys = 1;
+    for ( size_t t = 0; t < T_ && exact_; ++t ) {
+        if ( keys > std::numeric_limits<size_t>::max() / O_ ) exact_ = false;
+        else keys *= O_;
+    }
+}
+
+template <typename F>
+size_t MultiTarget::combine(Keys * keys, F observation) const {
+    if ( exact_ ) {
+        size_t key = 0;
+        for ( size_t t = 0; t < T_; ++t )
+            key = key * O_ + observation(t);
+        return key;
+    }
+    Observation o(T_);
+    for ( size_t t = 0; t < T_; ++t )
+        o[t] = observation(t);
+    return keys->intern(o.data());
+}
+
+inline size_t MultiTarget::key(const Observation & o, Keys * keys) const {
+    if ( o.size() != T_ ) throw std::invalid_argument("MultiTarget needs one observation per target");
+    for ( auto ot : o )
+        if ( ot >= O_ ) throw std::invalid_argument("MultiTarget received an observation out of range");
+
+    return combine(keys, [&o](size_t t) { return o[t]; });
+}
+
+inline size_t MultiTarget::distance(size_t k1, size_t k2, Keys * keys) const {
+    if ( !exact_ ) return keys->distance(k1, k2);
+
+    size_t d = 0;
+    for ( size_t t = 0; t < T_; ++t, k1 /= O_, k2 /= O_ )
+        d += k1 % O_ > k2 % O_ ? k1 % O_ - k2 % O_ : k2 % O_ - k1 % O_;
+    return d;
+}
+
+inline MultiTarget::Keys::Keys(size_t targets, Arena & arena) : T_(targets), shards_(arena) {
+    shards_.reserve(Shards);
+    for ( size_t i = 0; i < Shards; ++i )
+        shards_.emplace_back(arena);
+}
+
+// Keys are numbered within their shard, and the shard is their remainder.
+inline size_t MultiTarget::Keys::intern(const size_t * o) {
+    const uint64_t h = hash(o);
+    const size_t s = ( h >> 32 ) % Shards;
+    auto & shard = shards_[s];
+
+    std::lock_guard<NodeLock> guard(shard.lock);
+    const size_t size = shard.observations.size() / T_;
+    if ( 2 * ( size + 1 ) > shard.index.size() ) grow(shard);
+
+    const size_t mask = shard.index.size() - 1;
+    for ( size_t i = h & mask; ; i = ( i + 1 ) & mask ) {
+        const uint32_t entry = shard.index[i];
+        if ( !entry ) {
+            shard.index[i] = size + 1;
+            shard.observations.insert(shard.observations.end(), o, o + T_);
+            return size * Shards + s;
+        }
+        if ( std::equal(o, o + T_, &shard.observations[( entry - 1 ) * T_]) )
+            return ( entry - 1 ) * Shards + s;
+    }
+}
+
+inline const size_t * MultiTarget::Keys::observation(size_t key) const {
+    return &shards_[key % Shards].observations[key / Shards * T_];
+}
+
+inline size_t MultiTarget::Keys::distance(size_t k1, size_t k2) {
+    // The shards are locked in order, so that threads cannot deadlock.
+    const size_t s1 = std::min(k1 % Shards, k2 % Shards), s2 = std::max(k1 % Shards, k2 % Shards);
+    std::lock_guard<NodeLock> guard1(shards_[s1].lock);
+    std::unique_lock<NodeLock> guard2(shards_[s2].lock, std::defer_lock);
+    if ( s1 != s2 ) guard2.lock();
+
+    const size_t * o1 = observation(k1), * o2 = observation(k2);
+    size_t d = 0;
+    for ( size_t t = 0; t < T_; ++t )
+        d += o1[t] > o2[t] ? o1[t] - o2[t] : o2[t] - o1[t];
+    return d;
+}
+
+inline uint64_t MultiTarget::Keys::hash(const size_t * o) const {
+    uint64_t h = 0;
+    for ( size_t t = 0; t < T_; ++t )
+        h = ( h ^ ( o[t] + 1 ) * 0x9E3779B97F4A7C15ull ) * 0x100000001B3ull + ( h >> 29 );
+    // The final mix spreads all bits, as both the shard and the slot use them.
+    h = ( h ^ ( h >> 31 ) ) * 0xBF58476D1CE4E5B9ull;
+    return h ^ ( h >> 32 );
+}
+
+// This doubles the slots of the shard, and inserts again all its keys.
+inline void MultiTarget::Keys::grow(Shard & shard) {
+    shard.index.assign(std::max<size_t>(16, shard.index.size() * 2), 0);
+    const size_t mask = shard.index.size() - 1;
+    const size_t size = shard.observations.size() / T_;
+    for ( size_t k = 0; k < size; ++k ) {
+        size_t i = hash(&shard.observations[k * T_]) & mask;
+        while ( shard.index[i] ) i = ( i + 1 ) & mask;
+        shard.index[i] = k + 1;
+    }
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MASTER_THESIS_THREAD_POOL_HEADER_FILE
+#define MASTER_THESIS_THREAD_POOL_HEADER_FILE
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// This is a very small fixed-size pool of threads. It is used by the planners
+// to spread their work over multiple cores without paying for thread creation
+// at every planning step. The calling thread always takes part in the work,
+// so a pool of size n has n-1 helper threads.
+class ThreadPool {
+    public:
+        using Job = std::function<void(unsigned)>;
+
+        ThreadPool(unsigned size);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        // This function calls job(i) for every i in [0, n), and returns once
+        // all calls have completed. Calls are spread over all threads.
+        void parallelFor(unsigned n, const Job & job);
+
+        unsigned size() const;
+
+    private:
+        void work();
+        // Runs job indices until there are none left. Expects the lock held.
+        void runJobs(std::unique_lock<std::mutex> & lock);
+
+        std::vector<std::thread> helpers_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_, done_;
+
+        const Job * job_;
+        unsigned jobSize_, next_, remaining_;
+        bool stop_;
+};
+
+#endif
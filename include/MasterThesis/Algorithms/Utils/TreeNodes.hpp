@@ -2,92 +2,240 @@
 #define MASTER_THESIS_TREE_NODES_HEADER_FILE
 
 #include <vector>
+#include <functional>
 #include <unordered_map>
 
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
 
-// #include <boost/pool/pool_alloc.hpp>
-
+#include <MasterThesis/Algorithms/Utils/Arena.hpp>
+#include <MasterThesis/Algorithms/Utils/FlatMap.hpp>
+#include <MasterThesis/Algorithms/Utils/NodeLock.hpp>
+#include <MasterThesis/Algorithms/Utils/KnowledgeMeasures.hpp>
+#include <MasterThesis/Random.hpp>
+
+// All nodes and their containers live in an Arena owned by the planner, so
+// that building the tree does not go through malloc, and so that a whole
+// tree can be dropped at once.
+//
+// Belief nodes are templated on the knowledge measure K (see
+// KnowledgeMeasures.hpp), so that each of them only stores what its measure
+// needs. Their code is instantiated in TreeNodes.cpp for all measures.
+
+template <typename K>
 struct ActionNode;
-using ActionNodes = std::vector<ActionNode>;
-
-struct BeliefParticle {
-    unsigned N = 0;             // Number of particles for this particular type (state)
-#ifdef ENTROPY
-    double negativeEntropy = 0; // Estimated entropy deriving from this particle type
-#endif
+template <typename K>
+using ActionNodes = std::vector<ActionNode<K>, ArenaAllocator<ActionNode<K>>>;
+
+// This keeps track of the copy of a subtree of belief nodes of type Node.
+// When nodes are shared by multiple parents (the tree is then a DAG), nodes
+// maps each node to its copy, so that shared nodes are only copied once.
+// count is the number of nodes copied so far, so that planners need not walk
+// the new tree to know it. When the new tree numbers observations
+// differently, rekey maps the key of each copied child to its new one.
+template <typename Node>
+struct NodeCopies {
+    NodeCopies(bool shared) : shared(shared), count(0) {}
+
+    bool shared;
+    std::unordered_map<const Node *, Node *> nodes;
+    size_t count;
+    std::function<size_t(size_t)> rekey;
 };
 
-// This is used to keep track of beliefs down in the tree. We use a map since
-// we do not need to sample from here, just to access fast and recompute the
-// entropy values.
-using TrackBelief  = std::unordered_map<
-                                    size_t, 
-                                    BeliefParticle,
-                                    std::hash<size_t>,
-                                    std::equal_to<size_t>
-                                    //,boost::fast_pool_allocator<std::pair<size_t, BeliefParticle>>
-                                    >;
+// This is used to keep track of beliefs down in the tree. We do not need to
+// sample from here, just to access fast and recompute the entropy values.
+// Nodes mostly contain few distinct states, and with random accesses a
+// linear search is only worth it for very few of them.
+template <typename K>
+using TrackBelief = FlatMap<typename K::Particle, 2>;
+
+// These are the statistics of the actions of a belief node. Each is kept in
+// its own contiguous array, so that selecting an action can score many of
+// them at once.
+struct ActionStats {
+    ActionStats(Arena & arena);
+    ActionStats(const ActionStats & other, Arena & arena);
+
+    void resize(size_t A);
+
+    // This returns the bytes a copy of the statistics takes in an arena.
+    size_t getCopyBytes() const;
+
+    // Tracks the value of each action, as a weighted average of the values
+    // of the next step beliefNodes.
+    std::vector<double, ArenaAllocator<double>> V;
+    std::vector<unsigned, ArenaAllocator<unsigned>> N;
+    std::vector<unsigned, ArenaAllocator<unsigned>> pending; // Number of threads currently searching below each action.
+};
 
+template <typename K>
 class BeliefNode {
     public:
-        BeliefNode();
+        BeliefNode(Arena & arena);
+        // This copies the whole subtree of the input node into the arena.
+        // Nodes visited less than minN times are collapsed into leaves:
+        // they keep their values and action statistics, but not their
+        // subtrees, which are grown again if they are visited. If copies is
+        // provided it counts the copied nodes, and shares them if needed.
+        BeliefNode(const BeliefNode & other, Arena & arena, unsigned minN = 0, NodeCopies<BeliefNode<K>> * copies = nullptr);
+
+        // This function creates the action nodes, if they are not there yet.
+        void addActions(size_t A);
 
         // This function updates the knowledge measure after adding a new belief particle.
-        void updateBeliefAndKnowledge(size_t s);    
+        void updateBeliefAndKnowledge(size_t s) {
+            K::update(knowledge_, trackBelief_[s], N);
+        }
 
         // This function returns the current estimate for reward for this node.
-        double getKnowledgeMeasure() const;         
+        double getKnowledgeMeasure() const {
+            return K::value(knowledge_);
+        }
+
+        const TrackBelief<K> & getTrackBelief() const { return trackBelief_; }
+
+        // These return the bytes a copy of this node takes in an arena: the
+        // first when it is collapsed into a leaf, and the second what its
+        // actions add to that when it is not (without the children nodes).
+        size_t getLeafBytes() const;
+        size_t getActionsBytes() const;
 
         unsigned N;          // Counter for number of times we went through this belief node.
-        ActionNodes children;
+        ActionNodes<K> children;
+        ActionStats stats;   // Statistics of each action in children.
+        NodeLock lock;       // Protects this node, its actions and their children when searching in parallel.
 
         double V;            // Estimated value for this belief, taking into account future rewards/actions.
         double actionsV;     // Estimated value for the actions (could be mean, max, or other)
         size_t bestAction;   // Tracker of best available action in MAX-mode, to select node value.
+        bool maxMode;        // Whether actionsV has switched from the mean to MAX-mode.
 
         void printTrackBelief() const;
 
     protected:
-        TrackBelief trackBelief_; // This is a particle belief which is easy to update
-
-        double knowledgeMeasure_; // Estimated entropy for this belief.
-#ifndef ENTROPY
-        size_t maxS_;             // This keeps track of the belief peak state for max of belief
-#endif
+        TrackBelief<K> trackBelief_;      // This is a particle belief which is easy to update
+        typename K::Knowledge knowledge_; // Estimated knowledge measure for this belief.
 };
 
-using BeliefNodes = std::unordered_map<size_t, BeliefNode>;
+// Children of action nodes are indexed by observation. They are allocated
+// separately in the arena, so they never move once created, and most action
+// nodes only see a handful of observations, so searching them linearly is
+// fast (keys are compared in the same cache lines).
+template <typename K>
+using BeliefNodes = FlatMap<BeliefNode<K> *, 8>;
 
+template <typename K>
 struct ActionNode {
-    BeliefNodes children;
-    double V       = 0.0; // Tracks the value of the action, as a weighted
-    // average of the values of the next step beliefNodes.
-    unsigned N     = 0;
+    ActionNode(Arena & arena);
+    ActionNode(const ActionNode & other, Arena & arena, unsigned minN = 0, NodeCopies<BeliefNode<K>> * copies = nullptr);
+
+    BeliefNodes<K> children;
 };
 
 // This is used to sample at the top of the tree. It is a vector containing a
 // state-count pair for each particle.
-using SampleBelief = std::vector<std::pair<size_t, unsigned>>;
+using SampleBelief = std::vector<std::pair<size_t, unsigned>, ArenaAllocator<std::pair<size_t, unsigned>>>;
+
+// This is an entry of the alias table used to sample the SampleBelief in
+// constant time. Each entry is a bucket holding beliefSize particles, cut of
+// which belong to its own state, and the rest to the alias state.
+struct AliasEntry {
+    unsigned cut;
+    unsigned alias;
+};
+
+using AliasTable = std::vector<AliasEntry, ArenaAllocator<AliasEntry>>;
+
+// These are the particles of a target at the top of the tree. Sampling is
+// done with an alias table, which is rebuilt whenever the particles change.
+class RootParticles {
+    public:
+        // Particles as state-count pairs.
+        using Particles = std::unordered_map<size_t, unsigned>;
+
+        RootParticles(Arena & arena);
+        RootParticles(const RootParticles & other, Arena & arena);
+
+        // This replaces the particles with beliefSize samples of the belief.
+        void assign(size_t beliefSize, const AIToolbox::POMDP::Belief & b, RandomEngine & rand);
+        // This replaces the particles with the ones of a belief node.
+        template <typename Belief>
+        void assign(const Belief & belief);
+        // This adds the input particles to the ones we sample from.
+        void add(const Particles & particles);
+
+        bool empty() const;
+        const SampleBelief & getParticles() const { return sampleBelief_; }
+        size_t sample(RandomEngine & rand) const;
+        size_t getMostCommon() const;
+        void print() const;
+
+    private:
+        void buildAliasTable();
+
+        SampleBelief sampleBelief_;         // This is a particle belief which is easy to sample
+        AliasTable alias_;                  // One entry per element of sampleBelief_
+        size_t beliefSize_;                 // This is the total number of particles for this belief, needed because of SampleBelief structure
+};
+
+template <typename Belief>
+void RootParticles::assign(const Belief & belief) {
+    sampleBelief_.clear();
+    sampleBelief_.reserve(belief.size());
+    beliefSize_ = 0;
+    for ( auto & pair : belief ) {
+        sampleBelief_.emplace_back(pair.first, pair.second.N);
+        beliefSize_ += pair.second.N;
+    }
+    buildAliasTable();
+}
 
 // This converts the unordered belief map of an ordinary belief node into a vector.
 // This should speed up the sampling process considerably.
-class HeadBeliefNode : public BeliefNode {
+//
+// All constructors build the new tree in the input arena; in particular the
+// one taking a BeliefNode copies its subtree, so that the arena holding the
+// old tree can then be released.
+template <typename K>
+class HeadBeliefNode : public BeliefNode<K> {
     public:
-        HeadBeliefNode(size_t A, std::default_random_engine & rand);
-        HeadBeliefNode(size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, std::default_random_engine & rand);
-        HeadBeliefNode(size_t A, BeliefNode && bn, std::default_random_engine & rand);
+        using Particles = RootParticles::Particles;
+
+        HeadBeliefNode(size_t A, Arena & arena, RandomEngine & rand);
+        HeadBeliefNode(size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, Arena & arena, RandomEngine & rand);
+        HeadBeliefNode(size_t A, const BeliefNode<K> & bn, Arena & arena, RandomEngine & rand, NodeCopies<BeliefNode<K>> * copies = nullptr);
+        // This creates an empty tree which samples from the same particles as the input one.
+        HeadBeliefNode(size_t A, const HeadBeliefNode & particles, Arena & arena, RandomEngine & rand);
+        // This copies the whole tree, collapsing nodes visited less than minN times (see BeliefNode).
+        HeadBeliefNode(const HeadBeliefNode & other, Arena & arena, unsigned minN, NodeCopies<BeliefNode<K>> * copies = nullptr);
+
+        // This adds the input particles to the ones we sample from.
+        void addParticles(const Particles & particles);
+        // If there are no particles, this samples beliefSize of them from
+        // the belief. It returns the number of targets refilled (0 or 1).
+        unsigned refill(size_t beliefSize, const AIToolbox::POMDP::Belief & b, RandomEngine & rand);
 
         bool isSampleBeliefEmpty() const;
+        const SampleBelief & getSampleBelief() const { return particles_.getParticles(); }
         size_t sampleBelief() const;
+        size_t sampleBelief(RandomEngine & rand) const;
         size_t getMostCommonParticle() const;
         void printSampleBelief() const;
 
+        unsigned visits;     // Visits since this node became the root, while N also counts the ones it had as a child.
+
     private:
-        std::default_random_engine * rand_; // We use POMCP one;
-        SampleBelief sampleBelief_;         // This is a particle belief which is easy to sample
-        size_t beliefSize_;                 // This is the total number of particles for this belief, needed because of SampleBelief structure
+        RandomEngine * rand_; // We use POMCP one;
+        RootParticles particles_;
 };
 
+extern template class BeliefNode<Entropy>;
+extern template struct ActionNode<Entropy>;
+extern template class HeadBeliefNode<Entropy>;
+
+extern template class BeliefNode<MaxBelief>;
+extern template struct ActionNode<MaxBelief>;
+extern template class HeadBeliefNode<MaxBelief>;
+
 #endif
@@ -3,28 +3,132 @@
 
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
-#include <AIToolbox/Impl/Seeder.hpp>
+#include <AIToolbox/Impl/UCB.hpp>
+#include <AIToolbox/Impl/ProgressiveWidening.hpp>
+#include <AIToolbox/PlannerStats.hpp>
 #include <unordered_map>
 #include <iostream>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <array>
+#include <cstdint>
+#include <unordered_set>
+#include <functional>
+#include <algorithm>
 
 #include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
+#include <MasterThesis/Algorithms/Utils/ModelTraits.hpp>
+#include <MasterThesis/Algorithms/Utils/LeafEvaluators.hpp>
+#include <MasterThesis/Algorithms/Utils/RootSelection.hpp>
+#include <MasterThesis/Algorithms/Utils/Targets.hpp>
+#include <MasterThesis/Algorithms/Utils/ThreadPool.hpp>
+#include <MasterThesis/Random.hpp>
 
 namespace ap = AIToolbox::POMDP;
 namespace a = AIToolbox;
 
 #ifndef DOXYGEN_SKIP
 // This is done to avoid bringing around the enable_if everywhere.
-template <typename M, typename = typename std::enable_if<ap::is_generative_model<M>::value>::type>
-class rPOMCP;
+template <typename M, typename K, typename E, typename R, typename P, typename = typename std::enable_if<ap::is_generative_model<M>::value>::type>
+class rPOMCPCore;
 
 #endif
 
 /**
- * @brief This class represents the rPOMCP online planner.
+ * @brief The rPOMCP online planner, which searches the root as any other node.
+ *
+ * See rPOMCPCore for the details. The submodular version, which tries all
+ * root actions equally, is in rPOMCPSubmod.hpp, and the version tracking
+ * multiple targets in a single tree in rPOMCPMulti.hpp.
  */
-template <typename M>
-class rPOMCP<M> {
+template <typename M, typename K = Entropy, typename E = FixedHeuristic>
+using rPOMCP = rPOMCPCore<M, K, E, UCBRoot, SingleTarget>;
+
+/**
+ * @brief This enum selects how rPOMCP uses multiple threads.
+ */
+enum class Parallelism {
+    Root, ///< Each thread builds its own tree, and the root statistics are merged.
+    Tree  ///< All threads search the same tree.
+};
+
+/**
+ * @brief This class represents the search core of the rPOMCP online planners.
+ *
+ * The planners only differ in how they select the action to try at the
+ * root of the tree, which is done by the root policy R (see
+ * RootSelection.hpp), and in what the tree tracks, which is done by the
+ * target policy P (see Targets.hpp); all other nodes use UCB1. The
+ * planners themselves are aliases of this class (see rPOMCP, rPOMCPSubmod
+ * and rPOMCPMulti).
+ *
+ * rPOMCP can plan using multiple threads in two ways.
+ *
+ * With root parallelization, each thread builds its own independent tree
+ * from the same root particles, using its own random generator, and at the
+ * end the statistics of the root actions of all trees are merged to select
+ * the action. When moving to the next timestep, the tree which has explored
+ * the selected branch the most is kept.
+ *
+ * With tree parallelization, all threads descend the same tree. Each node
+ * is protected by its own lock, which is only held while reading or
+ * updating its statistics and children. While a thread is searching below
+ * an action, that action receives a virtual loss, so that other threads are
+ * pushed to explore other branches. This results in a single deeper tree,
+ * which is better when the observation space is large.
+ *
+ * Threads are only used if the model can be sampled concurrently (see
+ * is_reentrant_generative_model); otherwise the work is simply done
+ * sequentially.
+ *
+ * Planning can be limited either by a number of iterations, or by time, in
+ * which case rPOMCP simulates until the time runs out and returns the best
+ * action found so far.
+ *
+ * When the observation space is large, most simulations end in new nodes
+ * visited only once. Progressive widening (see setProgressiveWidening())
+ * bounds the observations each action can branch into, so that the
+ * simulations go deeper instead.
+ *
+ * Different histories often lead to the same belief. With transpositions
+ * (see setTranspositions()), nodes at the same depth which are reached with
+ * the same last action-observation pairs are merged, so that the tree
+ * becomes a DAG in which their visits and values are shared.
+ *
+ * Simulations stop at the first node they create. The value of such nodes
+ * is estimated by the leaf evaluator E, which by default gives them 0, and
+ * can also perform a rollout or call any function (see LeafEvaluators.hpp).
+ *
+ * Simulations can also be advanced in lockstep (see setLockstepBatch()).
+ * A batch of simulations descends the tree one depth at a time, and all
+ * their steps at that depth are sampled from the model with a single call
+ * (see is_batch_generative_model). As with tree parallelization, actions
+ * being searched by other simulations of the batch receive a virtual loss.
+ *
+ * The memory used by each tree can be capped with setMemoryLimit(). When a
+ * tree goes over the limit, its least visited nodes are collapsed into
+ * leaves, which keep their value estimates but lose their subtrees, until
+ * the tree takes about half of the limit.
+ *
+ * @tparam M The generative model to plan on.
+ * @tparam K The knowledge measure used as reward of the beliefs (see KnowledgeMeasures.hpp).
+ * @tparam E The evaluator of the new leaves of the tree (see LeafEvaluators.hpp).
+ * @tparam R The policy selecting the actions at the root (see RootSelection.hpp).
+ * @tparam P The policy defining the targets tracked by the tree (see Targets.hpp).
+ */
+template <typename M, typename K, typename E, typename R, typename P>
+class rPOMCPCore<M, K, E, R, P> {
     public:
+        using Knowledge = K;
+        using LeafEvaluator = E;
+        using Targets = P;
+        using BeliefNode = typename P::template BeliefNode<K>;
+        using HeadBeliefNode = typename P::template HeadBeliefNode<K>;
+        using State = typename P::State;
+        using Observation = typename P::Observation;
+        using Keys = typename P::Keys;
+        using Clock = std::chrono::steady_clock;
 
         /**
          * @brief Basic constructor.
@@ -34,11 +138,47 @@ class rPOMCP<M> {
          * @param iterations The number of episodes to run before completion.
          * @param exp The exploration constant. This parameter is VERY important to determine the final rPOMCP performance.
          * @param k The number of samples a belief node must have before it switches to MAX. If very very high is nearly equal to mean.
+         * @param threads The number of threads to use. The iterations are split between them.
+         * @param parallelism Whether threads build separate trees or share a single one.
          */
-        rPOMCP(const M& m, size_t beliefSize, unsigned iterations, double exp, unsigned k = 500);
+        rPOMCPCore(const M& m, size_t beliefSize, unsigned iterations, double exp, unsigned k = 500, unsigned threads = 1, Parallelism parallelism = Parallelism::Root);
 
+        /**
+         * @brief Constructor with the target policy to use.
+         *
+         * This is needed when the policy has parameters, as MultiTarget.
+         *
+         * @param m The POMDP model that rPOMCP will operate upon.
+         * @param targets The target policy.
+         * @param beliefSize The size of the initial particle belief of each target.
+         * @param iterations The number of episodes to run before completion.
+         * @param exp The exploration constant. This parameter is VERY important to determine the final rPOMCP performance.
+         * @param k The number of samples a belief node must have before it switches to MAX. If very very high is nearly equal to mean.
+         * @param threads The number of threads to use. The iterations are split between them.
+         * @param parallelism Whether threads build separate trees or share a single one.
+         */
+        rPOMCPCore(const M& m, const P & targets, size_t beliefSize, unsigned iterations, double exp, unsigned k = 500, unsigned threads = 1, Parallelism parallelism = Parallelism::Root);
+
+        /**
+         * @brief This function returns the most likely state of the target.
+         *
+         * This is only available when tracking a single target.
+         *
+         * @return The most common particle at the root.
+         */
         size_t getGuess() const;
 
+        /**
+         * @brief This function returns the most likely state of a target.
+         *
+         * This is only available when tracking multiple targets.
+         *
+         * @param target The target to guess.
+         *
+         * @return The most common particle of the target at the root.
+         */
+        size_t getGuess(size_t target) const;
+
         /**
          * @brief This function resets the internal graph and samples for the provided belief and horizon.
          *
@@ -66,17 +206,83 @@ class rPOMCP<M> {
          * using the existing graph: this should make search faster,
          * and also not require any belief updates.
          *
-         * NOTE: Currently there is no particle reinvigoration
-         * implemented, so for long horizons you can expect
-         * progressively degrading performances.
+         * If the new root has less than getBeliefSize() particles,
+         * it is reinvigorated: particles of the old root are propagated
+         * through the model and weighted by the probability of the
+         * observation (or kept only if they produce it, when the model
+         * is only generative), and then resampled to fill the gap. Only
+         * if no particle at all can be found rPOMCP restarts from a
+         * uniform belief; see getFallbacks(). When tracking multiple
+         * targets this is done for each target, and only the targets
+         * which lost all particles restart, together with the tree.
+         *
+         * @param a The action taken in the last timestep.
+         * @param o The observation received in the last timestep (one per target when tracking multiple targets).
+         * @param horizon The horizon to plan for.
+         *
+         * @return The best action.
+         */
+        size_t sampleAction(size_t a, const Observation & o, unsigned horizon);
+
+        /**
+         * @brief This function resets the internal graph and samples until the deadline.
+         *
+         * This function works as sampleAction(const ap::Belief&, unsigned),
+         * but ignores the number of iterations, and instead keeps
+         * simulating until the deadline. The clock is only checked every
+         * few simulations, so the deadline may be overshot by the time it
+         * takes to do them.
+         *
+         * At least a few simulations are always performed, even if the
+         * deadline has already passed.
+         *
+         * @param b The initial belief for the environment.
+         * @param horizon The horizon to plan for.
+         * @param deadline The time at which to stop planning.
+         *
+         * @return The best action.
+         */
+        size_t sampleAction(const ap::Belief& b, unsigned horizon, Clock::time_point deadline);
+
+        /**
+         * @brief This function resets the internal graph and samples for the specified time.
+         *
+         * @param b The initial belief for the environment.
+         * @param horizon The horizon to plan for.
+         * @param budget The time to spend planning, starting now.
+         *
+         * @return The best action.
+         */
+        size_t sampleAction(const ap::Belief& b, unsigned horizon, Clock::duration budget);
+
+        /**
+         * @brief This function uses the internal graph to plan until the deadline.
+         *
+         * This function works as sampleAction(size_t, const Observation&, unsigned),
+         * but ignores the number of iterations, and instead keeps
+         * simulating until the deadline. If the graph must be reset,
+         * the time spent doing so counts towards the deadline.
+         *
+         * @param a The action taken in the last timestep.
+         * @param o The observation received in the last timestep.
+         * @param horizon The horizon to plan for.
+         * @param deadline The time at which to stop planning.
+         *
+         * @return The best action.
+         */
+        size_t sampleAction(size_t a, const Observation & o, unsigned horizon, Clock::time_point deadline);
+
+        /**
+         * @brief This function uses the internal graph to plan for the specified time.
          *
          * @param a The action taken in the last timestep.
          * @param o The observation received in the last timestep.
          * @param horizon The horizon to plan for.
+         * @param budget The time to spend planning, starting now.
          *
          * @return The best action.
          */
-        size_t sampleAction(size_t a, size_t o, unsigned horizon);
+        size_t sampleAction(size_t a, const Observation & o, unsigned horizon, Clock::duration budget);
 
         /**
          * @brief This function sets the new size for initial beliefs created from sampleAction().
@@ -109,6 +315,90 @@ class rPOMCP<M> {
          */
         void setExploration(double exp);
 
+        /**
+         * @brief This function sets the virtual loss used in tree parallelization.
+         *
+         * Each thread currently searching below an action lowers its
+         * value as if it had returned this much less than its current
+         * estimate. Higher values spread threads more across the tree.
+         *
+         * @param loss The new virtual loss.
+         */
+        void setVirtualLoss(double loss);
+
+        /**
+         * @brief This function sets the progressive widening of the observations.
+         *
+         * An action tried N times can have at most max(1, k * N^alpha)
+         * observation children. Once an action has as many as allowed,
+         * samples with new observations are merged into the child with
+         * the closest observation (the distance is given by the target
+         * policy), which gets both the visit and the particle. For the same reason,
+         * sampleAction(a, o, ...) continues from the closest child when
+         * the real observation has none.
+         *
+         * @param k The widening constant, 0 to disable widening.
+         * @param alpha The widening exponent, in [0, 1].
+         */
+        void setProgressiveWidening(double k, double alpha);
+
+        /**
+         * @brief This function sets the maximum memory each search tree can use.
+         *
+         * The limit is checked every few hundred simulations of each
+         * thread, so between checks a tree grows past it by what those
+         * simulations add. A tree over the limit is compacted to about
+         * half of it, by collapsing its least visited nodes into leaves,
+         * so that it can grow for a while before being compacted again.
+         * Trees are checked once more when the search ends, so the tree
+         * kept for the next call is within the limit, unless the root and
+         * its children alone are larger. With root parallelization the
+         * limit applies to each tree.
+         *
+         * @param bytes The new limit, or 0 for no limit.
+         */
+        void setMemoryLimit(size_t bytes);
+
+        /**
+         * @brief This function sets how many simulations are advanced in lockstep.
+         *
+         * When larger than 1, each thread runs its simulations in
+         * batches of this size, sampling the model once per depth for
+         * the whole batch rather than once per step. This pays off
+         * when the model implements sampleSORBatch; otherwise the
+         * batch is sampled one step at a time.
+         *
+         * @param batch The new batch size, 0 or 1 to simulate one at a time.
+         */
+        void setLockstepBatch(unsigned batch);
+
+        /**
+         * @brief This function sets how many action-observation pairs identify a node for transpositions.
+         *
+         * When a simulation would create a node, rPOMCP first looks for a
+         * node at the same depth whose last `suffix` action-observation
+         * pairs are the same, and if there is one it links it instead.
+         * Short suffixes share more, but merge beliefs which may differ
+         * more. Shared nodes back up to each of their parents as much as
+         * that parent has tried the action leading to them.
+         *
+         * @param suffix The number of pairs, at most 4; 0 disables transpositions.
+         */
+        void setTranspositions(unsigned suffix);
+
+        /**
+         * @brief This function sets the evaluator of the new leaves.
+         *
+         * When a simulation creates a node before the maximum depth it
+         * stops there, and the node is given the value returned by the
+         * evaluator. This is the only information such simulations give
+         * about the future, so a good evaluator allows rPOMCP to decide as
+         * well with fewer simulations.
+         *
+         * @param evaluator The new evaluator.
+         */
+        void setLeafEvaluator(const E & evaluator);
+
         /**
          * @brief This function returns the POMDP generative model being used.
          *
@@ -123,6 +413,20 @@ class rPOMCP<M> {
          */
         const HeadBeliefNode& getGraph() const;
 
+        /**
+         * @brief This function returns the policy defining the tracked targets.
+         *
+         * @return The target policy.
+         */
+        const P & getTargetPolicy() const;
+
+        /**
+         * @brief This function returns the number of tracked targets.
+         *
+         * @return The number of targets.
+         */
+        size_t getTargets() const;
+
         /**
          * @brief This function returns the initial particle size for converted Beliefs.
          *
@@ -144,138 +448,869 @@ class rPOMCP<M> {
          */
         double getExploration() const;
 
+        /**
+         * @brief This function returns the number of threads used to plan.
+         *
+         * @return The number of threads.
+         */
+        unsigned getThreads() const;
+
+        /**
+         * @brief This function returns how the threads are used to plan.
+         *
+         * @return The parallelization mode.
+         */
+        Parallelism getParallelism() const;
+
+        /**
+         * @brief This function returns the virtual loss used in tree parallelization and lockstep simulations.
+         *
+         * @return The virtual loss.
+         */
+        double getVirtualLoss() const;
+
+        /**
+         * @brief This function returns the progressive widening constant.
+         *
+         * @return The widening constant, 0 if widening is disabled.
+         */
+        double getWideningConstant() const;
+
+        /**
+         * @brief This function returns the progressive widening exponent.
+         *
+         * @return The widening exponent.
+         */
+        double getWideningExponent() const;
+
+        /**
+         * @brief This function returns the maximum memory each search tree can use.
+         *
+         * @return The memory limit in bytes, 0 if there is none.
+         */
+        size_t getMemoryLimit() const;
+
+        /**
+         * @brief This function returns how many simulations are advanced in lockstep.
+         *
+         * @return The batch size, 0 or 1 if simulations are run one at a time.
+         */
+        unsigned getLockstepBatch() const;
+
+        /**
+         * @brief This function returns how many action-observation pairs identify a node for transpositions.
+         *
+         * @return The number of pairs, 0 if transpositions are disabled.
+         */
+        unsigned getTranspositions() const;
+
+        /**
+         * @brief This function returns the evaluator of the new leaves.
+         *
+         * @return The leaf evaluator.
+         */
+        const E & getLeafEvaluator() const;
+
+        /**
+         * @brief This function returns the number of simulations performed by the last sampleAction call.
+         *
+         * This is mostly useful when planning with a time budget.
+         *
+         * @return The number of simulations, summed over all threads.
+         */
+        unsigned getSimulations() const;
+
+        /**
+         * @brief This function returns how many times rPOMCP had to restart from a uniform belief.
+         *
+         * This happens when rerooting cannot find nor generate any
+         * particle consistent with the action and observation. Each
+         * target restarting counts once.
+         *
+         * @return The number of fallbacks since construction.
+         */
+        unsigned getFallbacks() const;
+
+        /**
+         * @brief This function returns what the last sampleAction call did.
+         *
+         * The wall time only includes the search, and not rerooting.
+         *
+         * @return The statistics of the last call.
+         */
+        const a::PlannerStats & getStats() const;
+
+        /**
+         * @brief This function returns the memory used by the search trees.
+         *
+         * This includes the trees of all threads, if any.
+         *
+         * @return The number of bytes currently allocated for the trees.
+         */
+        size_t getBytesInUse() const;
+
     private:
+        // Maximum number of action-observation pairs identifying a node for transpositions.
+        enum : unsigned { MaxTranspositionSuffix = 4 };
+        // The hashes of the last action-observation pairs of a simulation, most recent first.
+        using History = std::array<uint64_t, MaxTranspositionSuffix>;
+
+        // This maps the depth and history of the nodes of a tree to the
+        // nodes themselves.
+        struct Transpositions {
+            std::unordered_map<uint64_t, BeliefNode *> nodes;
+            NodeLock lock;
+        };
+
+        // Each additional thread has its own generator, and builds its own
+        // tree in root parallelization. In tree parallelization it searches
+        // the main tree, so it has no arenas nor tree.
+        struct Worker {
+            Worker(uint64_t seed);
+
+            RandomEngine rand;
+            std::unique_ptr<Arena> arena, spare;
+            HeadBeliefNode * graph;
+            Keys * keys;
+            Transpositions transpositions;
+        };
+
+        // The particles given to the leaf evaluator.
+        using LeafParticles = typename P::template LeafParticles<K>;
+
+        // What a thread uses while simulating on a tree.
+        struct Context {
+            RandomEngine & rand;
+            a::PlannerStats & stats;
+            Keys * keys;
+            Transpositions & transpositions;
+            LeafParticles & leaf;
+        };
+
+        // Buffers for lockstep simulations, one per thread so that they are
+        // only allocated once.
+        struct Step {
+            BeliefNode * node;
+            size_t a;
+            unsigned edgeVisits;
+        };
+        struct Batch {
+            std::vector<Step> path;         // maxDepth_ steps for each simulation.
+            std::vector<History> histories;
+            std::vector<unsigned> active, length;
+            std::vector<double> values;
+            std::vector<State> states;
+            std::vector<size_t> actions, observations;
+            StepBuffers buffers;
+        };
+
         const M& model_;
+        P targets_;
         size_t S, A, beliefSize_;
-        unsigned iterations_, maxDepth_;
-        double exploration_;
-        unsigned k_;
+        unsigned iterations_, maxDepth_, simulations_, fallbacks_;
+        double exploration_, virtualLoss_, wideningK_, wideningAlpha_;
+        unsigned k_, threads_;
+        Parallelism parallelism_;
+        size_t memoryLimit_;
+        unsigned lockstepBatch_, transpositionSuffix_;
+        E evaluator_;
+
+        mutable RandomEngine rand_;
+
+        // The tree lives in arena_. When rerooting the kept subtree is
+        // copied in spare_, and the two are swapped. With tree
+        // parallelization they have a lane for each thread. Keys, if the
+        // targets need them, live in the arena of their tree.
+        std::unique_ptr<Arena> arena_, spare_;
+        HeadBeliefNode * graph_;
+        Keys * keys_;
+        Transpositions transpositions_;
+        size_t nodesReused_; // Nodes below the root kept by the last reroot.
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::unique_ptr<ThreadPool> pool_;
+
+        // Each thread records its own statistics, which are then merged.
+        a::PlannerStats stats_;
+        std::vector<a::PlannerStats> threadStats_;
+        std::vector<Batch> batches_;
+        std::vector<LeafParticles> leafParticles_;
+
+        // Simulations performed between checks of the clock.
+        enum : unsigned { ClockInterval = 16 };
+        // Simulations performed by each thread between checks of the memory limit.
+        enum : unsigned { MemoryCheckInterval = 256 };
 
-        mutable std::default_random_engine rand_;
+        // Private Methods
+        // When the deadline is Clock::time_point::max() we only count iterations.
+        size_t sampleAction(const ap::Belief& b, unsigned horizon, unsigned iterations, Clock::time_point deadline);
+        size_t sampleAction(size_t a, const Observation & o, unsigned horizon, unsigned iterations, Clock::time_point deadline);
+
+        size_t runSimulation(unsigned horizon, unsigned iterations, Clock::time_point deadline);
+        void compact(HeadBeliefNode *& graph, Keys *& keys, std::unique_ptr<Arena> & arena, std::unique_ptr<Arena> & spare, Transpositions & transpositions);
+        template <typename F>
+        void forEachNode(const BeliefNode & root, F f) const;
+
+        History extendHistory(const History & history, size_t a, size_t o) const;
+        uint64_t transpositionKey(unsigned depth, const History & history) const;
+        void indexTranspositions(HeadBeliefNode & graph, Transpositions & transpositions);
+        void indexNode(BeliefNode & b, unsigned depth, const History & history, Transpositions & transpositions);
+
+        template <typename F>
+        unsigned simulateUntil(unsigned iterations, Clock::time_point deadline, F simulateBatch);
+        template <typename Guard>
+        void search(HeadBeliefNode & graph, unsigned iterations, unsigned thread);
+        template <typename Guard>
+        double simulate(BeliefNode & b, State & s, unsigned depth, const History & history, unsigned edgeVisits, Context & context);
+        template <typename Guard>
+        void simulateLockstep(HeadBeliefNode & graph, unsigned n, Batch & batch, Context & context);
+        template <typename Guard>
+        BeliefNode * expand(BeliefNode & b, size_t a, const State & s1, size_t o, unsigned depth, const History & history, double & leafValue, bool & evaluate, Context & context);
+        double backup(BeliefNode & b, size_t a, double immAndFutureRew, unsigned depth, unsigned edgeVisits);
+
+        void maxBeliefNodeUpdate(BeliefNode& bn, size_t a);
+
+        size_t findBestA(const BeliefNode & b);
+        size_t findBestBonusA(const BeliefNode & b, bool virtualLoss);
+
+        // The root policy chooses the root actions, and UCB1 all others.
+        size_t selectAction(const BeliefNode & b, unsigned depth, bool virtualLoss);
+};
 
-        HeadBeliefNode graph_;
+template <typename M, typename K, typename E, typename R, typename P>
+rPOMCPCore<M, K, E, R, P>::rPOMCPCore(const M& m, size_t beliefSize, unsigned iter, double exp, unsigned k, unsigned threads, Parallelism parallelism) :
+    rPOMCPCore(m, P(), beliefSize, iter, exp, k, threads, parallelism) {}
+
+template <typename M, typename K, typename E, typename R, typename P>
+rPOMCPCore<M, K, E, R, P>::rPOMCPCore(const M& m, const P & targets, size_t beliefSize, unsigned iter, double exp, unsigned k, unsigned threads, Parallelism parallelism) : model_(m), targets_(targets), S(model_.getS()), A(model_.getA()),
+    beliefSize_(beliefSize), iterations_(iter), simulations_(0), fallbacks_(0),
+    exploration_(exp), virtualLoss_(1.0), wideningK_(0.0), wideningAlpha_(0.5), k_(k), threads_(std::max(threads, 1u)), parallelism_(parallelism), memoryLimit_(0), lockstepBatch_(0), transpositionSuffix_(0),
+    rand_(RandomStreams::getSeed()),
+    arena_(new Arena(parallelism_ == Parallelism::Tree ? threads_ : 1)), spare_(new Arena(parallelism_ == Parallelism::Tree ? threads_ : 1)),
+    graph_(targets_.template makeRoot<K>(A, *arena_, rand_)), keys_(targets_.makeKeys(*arena_)), nodesReused_(0)
+{
+    // The threads draw from independent streams, derived from our own
+    // generator so that they are reproducible under a master seed.
+    const uint64_t stream = rand_();
+    for ( unsigned t = 1; t < threads_; ++t ) {
+        workers_.emplace_back(new Worker(RandomStreams::getSeed(stream, t)));
+        if ( parallelism_ != Parallelism::Root ) continue;
+
+        auto & w = *workers_.back();
+        w.arena.reset(new Arena());
+        w.spare.reset(new Arena());
+        w.graph = targets_.template makeRoot<K>(A, *w.arena, w.rand);
+        w.keys = targets_.makeKeys(*w.arena);
+    }
+    threadStats_.resize(threads_);
+    batches_.resize(threads_);
+    leafParticles_.resize(threads_);
 
-        // Private Methods
-        size_t runSimulation(unsigned horizon);
-        double simulate(BeliefNode & b, size_t s, unsigned horizon);
+    if ( threads_ > 1 && is_reentrant_generative_model<M>::value )
+        pool_.reset(new ThreadPool(threads_));
+}
 
-        double maxBeliefNodeUpdate(BeliefNode& bn, const ActionNode & aNode, size_t a);
+template <typename M, typename K, typename E, typename R, typename P>
+rPOMCPCore<M, K, E, R, P>::Worker::Worker(uint64_t seed) : rand(seed), graph(nullptr), keys(nullptr) {}
 
-        template <typename Iterator>
-        Iterator findBestA(Iterator begin, Iterator end);
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(const ap::Belief& b, unsigned horizon) {
+    return sampleAction(b, horizon, iterations_, Clock::time_point::max());
+}
 
-        template <typename Iterator>
-        Iterator findBestBonusA(Iterator begin, Iterator end, unsigned count);
-};
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(const ap::Belief& b, unsigned horizon, Clock::time_point deadline) {
+    return sampleAction(b, horizon, std::numeric_limits<unsigned>::max(), deadline);
+}
 
-template <typename M>
-rPOMCP<M>::rPOMCP(const M& m, size_t beliefSize, unsigned iter, double exp, unsigned k) : model_(m), S(model_.getS()), A(model_.getA()),
-    beliefSize_(beliefSize), iterations_(iter),
-    exploration_(exp), k_(k),
-    rand_(AIToolbox::Impl::Seeder::getSeed()), graph_(A, rand_) {}
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(const ap::Belief& b, unsigned horizon, Clock::duration budget) {
+    return sampleAction(b, horizon, Clock::now() + budget);
+}
 
-    template <typename M>
-    size_t rPOMCP<M>::sampleAction(const ap::Belief& b, unsigned horizon) {
-        // Reset graph
-        graph_ = HeadBeliefNode(A, beliefSize_, b, rand_);
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(size_t a, const Observation & o, unsigned horizon) {
+    return sampleAction(a, o, horizon, iterations_, Clock::time_point::max());
+}
 
-        return runSimulation(horizon);
-    }
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(size_t a, const Observation & o, unsigned horizon, Clock::time_point deadline) {
+    return sampleAction(a, o, horizon, std::numeric_limits<unsigned>::max(), deadline);
+}
 
-template <typename M>
-size_t rPOMCP<M>::getGuess() const {
-    return graph_.getMostCommonParticle();
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(size_t a, const Observation & o, unsigned horizon, Clock::duration budget) {
+    return sampleAction(a, o, horizon, Clock::now() + budget);
 }
 
-template <typename M>
-size_t rPOMCP<M>::sampleAction(size_t a, size_t o, unsigned horizon) {
-    auto & obs = graph_.children[a].children;
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(const ap::Belief& b, unsigned horizon, unsigned iterations, Clock::time_point deadline) {
+    // Reset graph
+    arena_->release();
+    graph_ = targets_.template makeRoot<K>(A, beliefSize_, b, *arena_, rand_);
+    keys_ = targets_.makeKeys(*arena_);
+    nodesReused_ = 0;
 
-    auto it = obs.find(o);
-    if ( it == obs.end() ) {
-        std::cerr << "Observation " << o << " never experienced in simulation, restarting with uniform belief..\n";
-        return sampleAction(ap::Belief(S, 1.0 / S), horizon);
-    }
+    return runSimulation(horizon, iterations, deadline);
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::getGuess() const {
+    return graph_->getMostCommonParticle();
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::getGuess(size_t target) const {
+    return graph_->getMostCommonParticle(target);
+}
 
-    // Here we need an additional step, because *it is contained by graph_.
-    // If we just move assign, graph_ is first going to delete everything it
-    // contains (included *it), and then we are going to move unallocated memory
-    // into graph_! So we move *it outside of the graph_ hierarchy, so that
-    // we can then assign safely.
-    { BeliefNode tmp = std::move(it->second); graph_ = HeadBeliefNode(A, std::move(tmp), rand_); }
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::sampleAction(size_t a, const Observation & o, unsigned horizon, unsigned iterations, Clock::time_point deadline) {
+    // With widening the observation may have been merged into the child of
+    // a close one, which we then continue from. Each tree has its own keys.
+    auto findChild = [this, a, &o](const HeadBeliefNode & graph, Keys * keys) -> BeliefNode * {
+        const size_t key = targets_.key(o, keys);
+        auto distance = [this, keys](size_t k1, size_t k2) { return targets_.distance(k1, k2, keys); };
+
+        auto & obs = graph.children[a].children;
+        if ( auto it = obs.find(key) ) return *it;
+        if ( wideningK_ > 0.0 && !obs.empty() ) return AIToolbox::Impl::closestObservation(obs, key, distance)->second;
+        return nullptr;
+    };
 
-    if ( graph_.isSampleBeliefEmpty() ) {
+    // If we have multiple trees, we keep the one which has explored the
+    // new root the most.
+    BeliefNode * next = findChild(*graph_, keys_);
+    const Keys * nextKeys = keys_;
+    for ( auto & w : workers_ ) {
+        if ( !w->graph ) continue;
+        BeliefNode * candidate = findChild(*w->graph, w->keys);
+        if ( candidate && ( !next || candidate->N > next->N ) ) {
+            next = candidate;
+            nextKeys = w->keys;
+        }
+    }
+
+    // The particles of non-root nodes are counted by N. If the new root
+    // has too few of them we generate more from the current root, which
+    // we need to do before dropping it.
+    typename HeadBeliefNode::Particles particles;
+    unsigned found = next ? next->N : 0;
+    if ( found < beliefSize_ )
+        targets_.reinvigorate(model_, *graph_, a, o, beliefSize_ - found, particles, rand_);
+
+    // We copy the subtree we keep into the spare arena, and then drop the
+    // old tree all at once. This is much faster than freeing all the
+    // discarded nodes one by one.
+    // The copy also counts the nodes we keep, besides the new root, and
+    // numbers again only the observations they use.
+    Keys * keys = targets_.makeKeys(*spare_);
+    NodeCopies<BeliefNode> copies(transpositionSuffix_ > 0);
+    copies.rekey = targets_.rekey(nextKeys, keys);
+    if ( next )
+        graph_ = spare_->make<HeadBeliefNode>(A, *next, *spare_, rand_, &copies);
+    else
+        graph_ = targets_.template makeRoot<K>(A, *spare_, rand_);
+    keys_ = keys;
+    nodesReused_ = copies.count ? copies.count - 1 : 0;
+    graph_->addParticles(particles);
+    std::swap(arena_, spare_);
+    spare_->release();
+
+    // Targets left without particles restart from a uniform belief. The
+    // statistics of the tree are not valid anymore, so we only keep the
+    // particles.
+    if ( unsigned lost = graph_->refill(beliefSize_, ap::Belief(S, 1.0 / S), rand_) ) {
+        fallbacks_ += lost;
         std::cerr << "rPOMCP Lost track of the belief, restarting with uniform..\n";
-        return sampleAction(ap::Belief(S, 1.0 / S), horizon);
+        graph_ = spare_->make<HeadBeliefNode>(A, *graph_, *spare_, rand_);
+        keys_ = targets_.makeKeys(*spare_);
+        std::swap(arena_, spare_);
+        spare_->release();
+        nodesReused_ = 0;
     }
 
-    return runSimulation(horizon);
+    return runSimulation(horizon, iterations, deadline);
 }
 
-template <typename M>
-size_t rPOMCP<M>::runSimulation(unsigned horizon) {
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::runSimulation(unsigned horizon, unsigned iterations, Clock::time_point deadline) {
+    simulations_ = 0;
+    stats_.reset(horizon);
     if ( !horizon ) return 0;
 
     maxDepth_ = horizon;
+    // The tree may have changed since the last call, so we find again the
+    // nodes to link to.
+    indexTranspositions(*graph_, transpositions_);
+
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+    const auto start = Clock::now();
+    stats_.nodesReused = nodesReused_;
+    for ( auto & ts : threadStats_ ) ts.reset(horizon);
+#endif
 
-    for (unsigned i = 0; i < iterations_; ++i )
-        simulate(graph_, graph_.sampleBelief(), 0);
+    // Each thread performs its own share of the iterations, and counts
+    // how many it did.
+    std::vector<unsigned> done(threads_);
+    auto share = [this, iterations](unsigned t) {
+        return iterations / threads_ + ( t < iterations % threads_ );
+    };
 
-    auto begin = std::begin(graph_.children);
-    size_t bestA = std::distance(begin, findBestA(begin, std::end(graph_.children)));
+    // With a memory limit the simulations are done in rounds, so that
+    // between them we can compact the trees with no thread searching them.
+    const unsigned round = memoryLimit_ ? static_cast<unsigned>(MemoryCheckInterval) : iterations;
+    auto runRounds = [&](std::function<void(unsigned, unsigned)> job) {
+        auto roundJob = [&](unsigned t) {
+            job(t, std::min(share(t) - done[t], round));
+        };
+        while ( true ) {
+            if ( pool_ ) pool_->parallelFor(threads_, roundJob);
+            else for ( unsigned t = 0; t < threads_; ++t ) roundJob(t);
+
+            bool left = false;
+            for ( unsigned t = 0; t < threads_; ++t )
+                left = left || done[t] < share(t);
+            if ( !memoryLimit_ ) break;
+
+            // This is also done after the last round, so that the tree we
+            // keep for the next step is within the limit.
+            if ( arena_->bytesInUse() > memoryLimit_ )
+                compact(graph_, keys_, arena_, spare_, transpositions_);
+            if ( parallelism_ == Parallelism::Root )
+                for ( auto & w : workers_ )
+                    if ( w->arena->bytesInUse() > memoryLimit_ )
+                        compact(w->graph, w->keys, w->arena, w->spare, w->transpositions);
+
+            if ( !left || Clock::now() >= deadline ) break;
+        }
+    };
+
+    if ( workers_.empty() ) {
+        runRounds([this, &done, deadline](unsigned, unsigned n) {
+            done[0] += simulateUntil(n, deadline, [this](unsigned m){
+                search<NullGuard>(*graph_, m, 0);
+            });
+        });
+    }
+    else if ( parallelism_ == Parallelism::Tree ) {
+        runRounds([this, &done, deadline](unsigned t, unsigned n) {
+            // Each thread allocates from its own lane of the shared arena.
+            Arena::Lane lane(t);
+            done[t] += simulateUntil(n, deadline, [this, t](unsigned m){
+                search<std::unique_lock<NodeLock>>(*graph_, m, t);
+            });
+        });
+    }
+    else {
+        // All workers start from the particles of the main tree.
+        for ( auto & w : workers_ ) {
+            w->arena->release();
+            w->graph = w->arena->template make<HeadBeliefNode>(A, *graph_, *w->arena, w->rand);
+            w->keys = targets_.makeKeys(*w->arena);
+            w->transpositions.nodes.clear();
+        }
+
+        runRounds([this, &done, deadline](unsigned t, unsigned n) {
+            auto & graph = t ? *workers_[t-1]->graph : *graph_;
+
+            done[t] += simulateUntil(n, deadline, [this, &graph, t](unsigned m){
+                search<NullGuard>(graph, m, t);
+            });
+        });
+
+        // We merge the root statistics of all trees in the main one, so
+        // that the action is selected using all simulations.
+        for ( auto & w : workers_ ) {
+            graph_->N += w->graph->N;
+            auto & stats = graph_->stats;
+            auto & wStats = w->graph->stats;
+            for ( size_t a = 0; a < A; ++a ) {
+                if ( !wStats.N[a] ) continue;
+
+                stats.N[a] += wStats.N[a];
+                stats.V[a] += ( wStats.V[a] - stats.V[a] ) * wStats.N[a] / static_cast<double>(stats.N[a]);
+            }
+        }
+    }
+
+    for ( auto d : done ) simulations_ += d;
+
+    size_t bestA = findBestA(*graph_);
 
     // Since we do not update the root value in simulate,
     // we do it here.
-    graph_.V = graph_.children[bestA].V;
+    graph_->V = graph_->stats.V[bestA];
+
+#ifndef AI_TOOLBOX_NO_PLANNER_STATS
+    for ( auto & ts : threadStats_ ) stats_.merge(ts);
+    stats_.simulations = simulations_;
+    stats_.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats_.bytes = getBytesInUse();
+#endif
     return bestA;
 }
 
-template <typename M>
-double rPOMCP<M>::simulate(BeliefNode & b, size_t s, unsigned depth) {
-    b.N++;
+// We copy the tree into the spare arena, collapsing the nodes which have
+// been visited the least. Keeping a node expanded costs its actions and its
+// children, so we keep the most visited nodes expanded as long as they fit
+// in half of the limit. Nodes are visited less than their parents, so all
+// the nodes we keep expanded stay reachable. The root is never collapsed.
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::compact(HeadBeliefNode *& graph, Keys *& keys, std::unique_ptr<Arena> & arena, std::unique_ptr<Arena> & spare, Transpositions & transpositions) {
+    // The visits and the cost of each expanded node.
+    std::vector<std::pair<unsigned, size_t>> expanded;
+    auto addNode = [&expanded](const BeliefNode & b) {
+        if ( b.children.empty() ) return;
+
+        size_t bytes = b.getActionsBytes();
+        for ( auto & aNode : b.children )
+            for ( auto & pair : aNode.children )
+                bytes += pair.second->getLeafBytes();
+        expanded.emplace_back(b.N, bytes);
+    };
+    addNode(*graph);
+    forEachNode(*graph, addNode);
+
+    std::sort(expanded.begin(), expanded.end(), [](const std::pair<unsigned, size_t> & lhs, const std::pair<unsigned, size_t> & rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    // Nodes with the same visits are all kept or all collapsed.
+    unsigned minN = 0;
+    size_t bytes = graph->getLeafBytes();
+    for ( auto & node : expanded ) {
+        bytes += node.second;
+        if ( bytes > memoryLimit_ / 2 ) {
+            minN = std::min(node.first + 1, graph->N);
+            break;
+        }
+    }
+
+    // Observations only reached from collapsed nodes lose their keys.
+    Keys * newKeys = targets_.makeKeys(*spare);
+    NodeCopies<BeliefNode> copies(transpositionSuffix_ > 0);
+    copies.rekey = targets_.rekey(keys, newKeys);
+    graph = spare->make<HeadBeliefNode>(*graph, *spare, minN, &copies);
+    keys = newKeys;
+    std::swap(arena, spare);
+    spare->release();
+
+    indexTranspositions(*graph, transpositions);
+}
+
+// This calls f once for each node below the root. With transpositions the
+// tree is a DAG, so we remember the nodes we have already seen.
+template <typename M, typename K, typename E, typename R, typename P>
+template <typename F>
+void rPOMCPCore<M, K, E, R, P>::forEachNode(const BeliefNode & root, F f) const {
+    std::vector<const BeliefNode *> stack(1, &root);
+    std::unordered_set<const BeliefNode *> seen;
+
+    while ( !stack.empty() ) {
+        const BeliefNode & b = *stack.back();
+        stack.pop_back();
+
+        for ( auto & aNode : b.children ) {
+            for ( auto & pair : aNode.children ) {
+                if ( transpositionSuffix_ && !seen.insert(pair.second).second ) continue;
+                f(*pair.second);
+                stack.push_back(pair.second);
+            }
+        }
+    }
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+auto rPOMCPCore<M, K, E, R, P>::extendHistory(const History & history, size_t a, size_t o) const -> History {
+    History extended;
+    extended[0] = ( a + 1 ) * 0x9E3779B97F4A7C15ull ^ ( o + 1 ) * 0xC2B2AE3D27D4EB4Full;
+    for ( unsigned i = 1; i < MaxTranspositionSuffix; ++i )
+        extended[i] = history[i - 1];
+    return extended;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+uint64_t rPOMCPCore<M, K, E, R, P>::transpositionKey(unsigned depth, const History & history) const {
+    uint64_t key = depth;
+    for ( unsigned i = 0; i < transpositionSuffix_; ++i )
+        key = ( key ^ history[i] ) * 0x100000001B3ull + ( key >> 29 );
+    return key;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::indexTranspositions(HeadBeliefNode & graph, Transpositions & transpositions) {
+    transpositions.nodes.clear();
+    if ( transpositionSuffix_ )
+        indexNode(graph, 0, History(), transpositions);
+}
+
+// Merged nodes have the same key whichever parent we reach them from, so
+// once a node is in the table we know its subtree has been indexed already.
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::indexNode(BeliefNode & b, unsigned depth, const History & history, Transpositions & transpositions) {
+    for ( size_t a = 0; a < b.children.size(); ++a ) {
+        for ( auto & pair : b.children[a].children ) {
+            History next = extendHistory(history, a, pair.first);
+            auto & node = transpositions.nodes[transpositionKey(depth + 1, next)];
+            if ( node == pair.second ) continue;
+            if ( !node ) node = pair.second;
+
+            indexNode(*pair.second, depth + 1, next, transpositions);
+        }
+    }
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+template <typename F>
+unsigned rPOMCPCore<M, K, E, R, P>::simulateUntil(unsigned iterations, Clock::time_point deadline, F simulateBatch) {
+    // Reading the clock is not free, so we only do it every few simulations.
+    const bool timed = deadline != Clock::time_point::max();
+    const unsigned interval = std::max(static_cast<unsigned>(ClockInterval), lockstepBatch_);
+
+    unsigned i = 0;
+    while ( i < iterations ) {
+        unsigned batch = std::min(iterations - i, interval);
+        simulateBatch(batch);
+        i += batch;
+
+        if ( timed && Clock::now() >= deadline ) break;
+    }
+    return i;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+template <typename Guard>
+void rPOMCPCore<M, K, E, R, P>::search(HeadBeliefNode & graph, unsigned iterations, unsigned t) {
+    // With root parallelization each tree has its own transpositions.
+    const bool own = t && parallelism_ == Parallelism::Root;
+    auto & transpositions = own ? workers_[t-1]->transpositions : transpositions_;
+    Context context{t ? workers_[t-1]->rand : rand_, threadStats_[t], own ? workers_[t-1]->keys : keys_, transpositions, leafParticles_[t]};
+
+    if ( lockstepBatch_ > 1 ) {
+        for ( unsigned i = 0; i < iterations; i += lockstepBatch_ )
+            simulateLockstep<Guard>(graph, std::min(iterations - i, lockstepBatch_), batches_[t], context);
+    }
+    else {
+        const auto noVisits = std::numeric_limits<unsigned>::max();
+        State s = targets_.makeState();
+        for ( unsigned i = 0; i < iterations; ++i ) {
+            targets_.sampleState(graph, s, context.rand);
+            simulate<Guard>(graph, s, 0, History(), noVisits, context);
+        }
+    }
+}
+
+// The Guard locks the node it is given. When searching in parallel, the
+// lock of a node protects its statistics, its actions and the children maps
+// of its actions. Locks are always taken going down the tree, and never held
+// while calling the model, the leaf evaluator or recursing, so threads
+// cannot deadlock.
+//
+// The history holds the last action-observation pairs leading to b, and
+// edgeVisits how many times its parent has tried the action leading to it.
+// The state is moved in place, as the previous one is not needed after
+// sampling.
+template <typename M, typename K, typename E, typename R, typename P>
+template <typename Guard>
+double rPOMCPCore<M, K, E, R, P>::simulate(BeliefNode & b, State & s, unsigned depth, const History & history, unsigned edgeVisits, Context & context) {
+    Guard lock(b.lock);
+    // The visits of all other nodes are counted by their parent, together
+    // with the belief update.
+    if ( depth == 0 ) {
+        b.N++;
+        static_cast<HeadBeliefNode &>(b).visits++;
+    }
 
     // Select next action node
-    auto begin = std::begin(b.children);
-    size_t a = std::distance(begin, findBestBonusA(begin, std::end(b.children), b.N));
-    auto & aNode = b.children[a];
+    size_t a = selectAction(b, depth, !std::is_same<Guard, NullGuard>::value);
+    b.stats.pending[a] += 1;
+    lock.unlock();
 
     // Generate next step
-    size_t s1, o;
-    std::tie(s1, o, std::ignore) = model_.sampleSOR(s, a);
+    size_t o = targets_.step(model_, s, a, context.keys, context.rand);
 
     double immAndFutureRew = 0.0;
-    {
-        typename decltype(aNode.children)::iterator ot;
-        bool newNode = false;
+    History next = extendHistory(history, a, o);
 
-        // This either adds a node or sets ot to the existing node.
-        ot = aNode.children.find(o);
-        if ( ot == aNode.children.end() ) {
-            newNode = true;
-            std::tie(ot, std::ignore) = aNode.children.insert(std::make_pair(o, BeliefNode()));
+    lock.lock();
+    bool evaluate = false;
+    BeliefNode * child = expand<Guard>(b, a, s, o, depth, next, immAndFutureRew, evaluate, context);
+    unsigned childVisits = transpositionSuffix_ ? b.stats.N[a] + 1 : std::numeric_limits<unsigned>::max();
+    lock.unlock();
+
+    if ( child )
+        immAndFutureRew = simulate<Guard>( *child, s, depth + 1, next, childVisits, context );
+    else if ( evaluate )
+        immAndFutureRew = evaluator_(model_, context.leaf, s, depth + 1, maxDepth_, context.rand);
+
+    lock.lock();
+    return backup(b, a, immAndFutureRew, depth, edgeVisits);
+}
+
+// Here the simulations of the batch go down the tree together. At each
+// depth we first select the actions of all the simulations still in the
+// tree, then sample all their steps at once, and then move each simulation
+// to its next node. Once all have left the tree, we back up their values.
+template <typename M, typename K, typename E, typename R, typename P>
+template <typename Guard>
+void rPOMCPCore<M, K, E, R, P>::simulateLockstep(HeadBeliefNode & graph, unsigned n, Batch & batch, Context & context) {
+    batch.path.resize(n * maxDepth_);
+    batch.histories.assign(n, History());
+    batch.active.resize(n);
+    batch.length.assign(n, 0);
+    batch.values.assign(n, 0.0);
+    batch.states.resize(n, targets_.makeState());
+    for ( unsigned i = 0; i < n; ++i ) {
+        batch.path[i * maxDepth_].node = &graph;
+        batch.path[i * maxDepth_].edgeVisits = std::numeric_limits<unsigned>::max();
+        batch.active[i] = i;
+        targets_.sampleState(graph, batch.states[i], context.rand);
+    }
+
+    for ( unsigned depth = 0; !batch.active.empty(); ++depth ) {
+        batch.actions.clear();
+        for ( auto i : batch.active ) {
+            auto & step = batch.path[i * maxDepth_ + depth];
+            BeliefNode & b = *step.node;
+
+            Guard lock(b.lock);
+            if ( depth == 0 ) {
+                b.N++;
+                graph.visits++;
+            }
+            // Other simulations of the batch may be searching below this
+            // node, so we always apply the virtual loss.
+            step.a = selectAction(b, depth, true);
+            b.stats.pending[step.a] += 1;
+
+            batch.actions.push_back(step.a);
         }
 
-        // Compute knowledge for new observation node (entropy/max belief)
-        // This needs to be done here since we are going to upgrade a future belief.
-        ot->second.updateBeliefAndKnowledge(s1);
+        // This moves the states of the active simulations in place.
+        targets_.stepBatch(model_, batch.states, batch.active, batch.actions, context.keys, batch.observations, batch.buffers, context.rand);
+
+        size_t kept = 0;
+        for ( size_t j = 0; j < batch.active.size(); ++j ) {
+            auto i = batch.active[j];
+            auto & step = batch.path[i * maxDepth_ + depth];
+
+            size_t o = batch.observations[j];
+            batch.histories[i] = extendHistory(batch.histories[i], step.a, o);
+
+            Guard lock(step.node->lock);
+            bool evaluate = false;
+            BeliefNode * child = expand<Guard>(*step.node, step.a, batch.states[i], o, depth, batch.histories[i], batch.values[i], evaluate, context);
+            if ( child ) {
+                auto & next = batch.path[i * maxDepth_ + depth + 1];
+                next.node = child;
+                next.edgeVisits = transpositionSuffix_ ? step.node->stats.N[step.a] + 1 : std::numeric_limits<unsigned>::max();
+                batch.active[kept++] = i;
+                continue;
+            }
+            batch.length[i] = depth + 1;
+            lock.unlock();
+
+            if ( evaluate )
+                batch.values[i] = evaluator_(model_, context.leaf, batch.states[i], depth + 1, maxDepth_, context.rand);
+        }
+        batch.active.resize(kept);
+    }
+
+    for ( unsigned i = 0; i < n; ++i ) {
+        double immAndFutureRew = batch.values[i];
+        for ( unsigned depth = batch.length[i]; depth-- > 0; ) {
+            auto & step = batch.path[i * maxDepth_ + depth];
+
+            Guard lock(step.node->lock);
+            immAndFutureRew = backup(*step.node, step.a, immAndFutureRew, depth, step.edgeVisits);
+        }
+    }
+}
+
+// This adds the sampled step to the child of b, which must be locked. It
+// returns the child if the simulation must go on from it, or otherwise
+// nullptr, and the value of the leaf in leafValue. The history is the one
+// of the child.
+//
+// New leaves are instead to be valued by the leaf evaluator, which the
+// caller must call once it has released the lock of b; evaluate is then
+// set, and the particles of b are copied in the context if the evaluator
+// needs them.
+template <typename M, typename K, typename E, typename R, typename P>
+template <typename Guard>
+auto rPOMCPCore<M, K, E, R, P>::expand(BeliefNode & b, size_t a, const State & s1, size_t o, unsigned depth, const History & history, double & leafValue, bool & evaluate, Context & context) -> BeliefNode * {
+    auto & aNode = b.children[a];
+    bool newNode = false;
 
-        // We only go deeper if needed (maxDepth_ is always at least 1).
-        if ( depth + 1 < maxDepth_ && !model_.isTerminal(s1) && !newNode) {
-            ot->second.children.resize(A);
-            immAndFutureRew = simulate( ot->second, s1, depth + 1 );
+    // This either gets the existing node, adds a node, or if the action
+    // cannot widen further gets the node of the closest observation.
+    BeliefNode * ot;
+    if ( auto found = aNode.children.find(o) ) {
+        ot = *found;
+    }
+    else if ( AIToolbox::Impl::canWiden(aNode.children.size(), b.stats.N[a] + b.stats.pending[a], wideningK_, wideningAlpha_) ) {
+        auto & arena = aNode.children.get_allocator().getArena();
+        if ( transpositionSuffix_ ) {
+            // A node with the same depth and history may exist already
+            // under another parent.
+            Guard tableLock(context.transpositions.lock);
+            auto & node = context.transpositions.nodes[transpositionKey(depth + 1, history)];
+            if ( !node ) {
+                newNode = true;
+                node = targets_.template makeNode<K>(arena);
+            }
+            ot = node;
         }
-        // Otherwise we increase the N for the bottom leaves, since they can't get it otherwise and is needed for entropy
         else {
-            ot->second.N += 1;
-            // For leaves we still extract entropy
-            if ( depth + 1 >= maxDepth_ )
-                immAndFutureRew = ot->second.getKnowledgeMeasure();
+            newNode = true;
+            ot = targets_.template makeNode<K>(arena);
         }
+        aNode.children[o] = ot;
+        if ( newNode ) context.stats.recordNode(depth + 1, aNode.children.size() == 1);
+    }
+    else {
+        auto distance = [this, &context](size_t k1, size_t k2) { return targets_.distance(k1, k2, context.keys); };
+        ot = AIToolbox::Impl::closestObservation(aNode.children, o, distance)->second;
+    }
+    // Nodes never move, even when other threads insert.
+    BeliefNode & child = *ot;
+
+    // We only go deeper if needed (maxDepth_ is always at least 1).
+    bool descend = depth + 1 < maxDepth_ && !targets_.isTerminal(model_, s1) && !newNode;
+    if ( !descend ) context.stats.recordLeaf(depth + 1, depth + 1 >= maxDepth_);
+
+    Guard childLock(child.lock);
+    // Compute knowledge for new observation node (entropy/max belief)
+    // This needs to be done here since we are going to upgrade a future belief.
+    child.updateBeliefAndKnowledge(s1);
+    child.N += 1;
+
+    if ( descend ) {
+        child.addActions(A);
+        return &child;
     }
+    // For leaves we still extract entropy, and new nodes are evaluated.
+    if ( depth + 1 >= maxDepth_ ) {
+        leafValue = child.getKnowledgeMeasure();
+    }
+    else if ( newNode ) {
+        evaluate = true;
+        if ( uses_leaf_particles<E>::value )
+            targets_.copyParticles(b, depth, context.leaf);
+    }
+    return nullptr;
+}
 
+// This updates b, which must be locked, with the value obtained by taking
+// action a, and returns the value to pass to its parent.
+template <typename M, typename K, typename E, typename R, typename P>
+double rPOMCPCore<M, K, E, R, P>::backup(BeliefNode & b, size_t a, double immAndFutureRew, unsigned depth, unsigned edgeVisits) {
     // Action update
-    aNode.N += 1;
-    aNode.V += ( immAndFutureRew - aNode.V ) / static_cast<double>(aNode.N);
+    auto & stats = b.stats;
+    stats.pending[a] -= 1;
+    stats.N[a] += 1;
+    stats.V[a] += ( immAndFutureRew - stats.V[a] ) / static_cast<double>(stats.N[a]);
 
     // At this point the current beliefNode has a correct estimate of its
     // own entropy. What it needs to do is select its best action. Although
@@ -288,12 +1323,14 @@ double rPOMCP<M>::simulate(BeliefNode & b, size_t s, unsigned depth) {
     // transmit a fake datapoint that will modify the value of the action
     // above as if we chose the best action all the time in the past.
     if ( b.N >= k_ ) {
-        // Force looking out for best action
-        if ( b.N == k_ ) {
+        // Force looking out for best action. Other simulations may have
+        // visited the node since the last backup, so N may be past k_.
+        if ( !b.maxMode ) {
+            b.maxMode = true;
             b.actionsV = HUGE_VAL;
             b.bestAction = a;
         }
-        maxBeliefNodeUpdate(b, aNode, a);
+        maxBeliefNodeUpdate(b, a);
     }
     else {
         b.actionsV += ( immAndFutureRew - b.actionsV ) / static_cast<double>(b.N);
@@ -304,96 +1341,200 @@ double rPOMCP<M>::simulate(BeliefNode & b, size_t s, unsigned depth) {
     // We discount the action part since it's the future reward part, while the
     // immediate reward is the direct entropy, which is not discounted
     b.V = model_.getDiscount() * b.actionsV + b.getKnowledgeMeasure();
-    // This replaces our old value with the new value in the action update
-    return (b.N - 1)*(b.V - oldV) + b.V;
+    // This replaces our old value with the new value in the action update.
+    // A node shared by multiple parents may have been visited more through
+    // the others, so we only replace as many values as this parent can have.
+    unsigned n = std::min(b.N, edgeVisits);
+    return (n - 1)*(b.V - oldV) + b.V;
 }
 
-template <typename M>
-double rPOMCP<M>::maxBeliefNodeUpdate(BeliefNode& b, const ActionNode & aNode, size_t a) {
-    if ( aNode.V >= b.actionsV ) {
-        b.actionsV   = aNode.V;
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::maxBeliefNodeUpdate(BeliefNode& b, size_t a) {
+    if ( b.stats.V[a] >= b.actionsV ) {
+        b.actionsV   = b.stats.V[a];
         b.bestAction = a;
     }
     // Note: This is needed because the value may go down!
     else if ( a == b.bestAction ) {
-        auto begin = std::begin(b.children);
-        auto it = findBestA(begin, std::end(b.children));
-        b.actionsV   = it->V;
-        b.bestAction = std::distance(begin, it);
+        b.bestAction = findBestA(b);
+        b.actionsV   = b.stats.V[b.bestAction];
     }
 }
 
-template <typename M>
-template <typename Iterator>
-Iterator rPOMCP<M>::findBestA(Iterator begin, Iterator end) {
-    return std::max_element(begin, end, [](const ActionNode & lhs, const ActionNode & rhs){ return lhs.V < rhs.V; });
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::findBestA(const BeliefNode & b) {
+    return AIToolbox::Impl::findBestA(b.stats.V.data(), A);
 }
 
-template <typename M>
-template <typename Iterator>
-Iterator rPOMCP<M>::findBestBonusA(Iterator begin, Iterator end, unsigned count) {
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::findBestBonusA(const BeliefNode & b, bool virtualLoss) {
     // Count here can be as low as 1.
     // Since log(1) = 0, and 0/0 = error, we add 1.0.
-    double logCount = std::log(count + 1.0);
-    // We use this function to produce a score for each action. This can be easily
-    // substituted with something else to produce different rPOMCP variants.
-    auto evaluationFunction = [this, logCount](const ActionNode & an){
-        return an.V + exploration_ * std::sqrt( logCount / an.N );
-    };
-
-    auto bestIterator = begin++;
-    double bestValue = evaluationFunction(*bestIterator);
-
-    for ( ; begin < end; ++begin ) {
-        double actionValue = evaluationFunction(*begin);
-        if ( actionValue > bestValue ) {
-            bestValue = actionValue;
-            bestIterator = begin;
-        }
-    }
+    double logCount = std::log(b.N + 1.0);
+    // When searching the same tree in parallel, actions which are being
+    // searched by other threads count as having been tried already, and as
+    // having returned less than expected.
+    if ( virtualLoss )
+        return AIToolbox::Impl::findBestBonusA(b.stats.V.data(), b.stats.N.data(), b.stats.pending.data(), A, logCount, exploration_, virtualLoss_);
+
+    return AIToolbox::Impl::findBestBonusA(b.stats.V.data(), b.stats.N.data(), A, logCount, exploration_);
+}
 
-    return bestIterator;
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::selectAction(const BeliefNode & b, unsigned depth, bool virtualLoss) {
+    if ( depth == 0 )
+        return R::select(static_cast<const HeadBeliefNode &>(b), A, [&]{ return findBestBonusA(b, virtualLoss); });
+    return findBestBonusA(b, virtualLoss);
 }
 
-template <typename M>
-void rPOMCP<M>::setBeliefSize(size_t beliefSize) {
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setBeliefSize(size_t beliefSize) {
     beliefSize_ = beliefSize;
 }
 
-template <typename M>
-void rPOMCP<M>::setIterations(unsigned iter) {
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setIterations(unsigned iter) {
     iterations_ = iter;
 }
 
-template <typename M>
-void rPOMCP<M>::setExploration(double exp) {
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setExploration(double exp) {
     exploration_ = exp;
 }
 
-template <typename M>
-const M& rPOMCP<M>::getModel() const {
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setVirtualLoss(double loss) {
+    virtualLoss_ = loss;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setProgressiveWidening(double k, double alpha) {
+    wideningK_ = k;
+    wideningAlpha_ = alpha;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setTranspositions(unsigned suffix) {
+    transpositionSuffix_ = std::min(suffix, static_cast<unsigned>(MaxTranspositionSuffix));
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setLeafEvaluator(const E & evaluator) {
+    evaluator_ = evaluator;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setMemoryLimit(size_t bytes) {
+    memoryLimit_ = bytes;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+void rPOMCPCore<M, K, E, R, P>::setLockstepBatch(unsigned batch) {
+    lockstepBatch_ = batch;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+const M& rPOMCPCore<M, K, E, R, P>::getModel() const {
     return model_;
 }
 
-template <typename M>
-const HeadBeliefNode& rPOMCP<M>::getGraph() const {
-    return graph_;
+template <typename M, typename K, typename E, typename R, typename P>
+auto rPOMCPCore<M, K, E, R, P>::getGraph() const -> const HeadBeliefNode & {
+    return *graph_;
 }
 
-template <typename M>
-size_t rPOMCP<M>::getBeliefSize() const {
+template <typename M, typename K, typename E, typename R, typename P>
+const P & rPOMCPCore<M, K, E, R, P>::getTargetPolicy() const {
+    return targets_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::getTargets() const {
+    return targets_.getTargets();
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::getBeliefSize() const {
     return beliefSize_;
 }
 
-template <typename M>
-unsigned rPOMCP<M>::getIterations() const {
+template <typename M, typename K, typename E, typename R, typename P>
+unsigned rPOMCPCore<M, K, E, R, P>::getIterations() const {
     return iterations_;
 }
 
-template <typename M>
-double rPOMCP<M>::getExploration() const {
+template <typename M, typename K, typename E, typename R, typename P>
+double rPOMCPCore<M, K, E, R, P>::getExploration() const {
     return exploration_;
 }
 
+template <typename M, typename K, typename E, typename R, typename P>
+unsigned rPOMCPCore<M, K, E, R, P>::getThreads() const {
+    return threads_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+Parallelism rPOMCPCore<M, K, E, R, P>::getParallelism() const {
+    return parallelism_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+double rPOMCPCore<M, K, E, R, P>::getVirtualLoss() const {
+    return virtualLoss_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+double rPOMCPCore<M, K, E, R, P>::getWideningConstant() const {
+    return wideningK_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+double rPOMCPCore<M, K, E, R, P>::getWideningExponent() const {
+    return wideningAlpha_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::getMemoryLimit() const {
+    return memoryLimit_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+unsigned rPOMCPCore<M, K, E, R, P>::getLockstepBatch() const {
+    return lockstepBatch_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+unsigned rPOMCPCore<M, K, E, R, P>::getTranspositions() const {
+    return transpositionSuffix_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+auto rPOMCPCore<M, K, E, R, P>::getLeafEvaluator() const -> const E & {
+    return evaluator_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+unsigned rPOMCPCore<M, K, E, R, P>::getSimulations() const {
+    return simulations_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+unsigned rPOMCPCore<M, K, E, R, P>::getFallbacks() const {
+    return fallbacks_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+const a::PlannerStats & rPOMCPCore<M, K, E, R, P>::getStats() const {
+    return stats_;
+}
+
+template <typename M, typename K, typename E, typename R, typename P>
+size_t rPOMCPCore<M, K, E, R, P>::getBytesInUse() const {
+    size_t bytes = arena_->bytesInUse();
+    for ( auto & w : workers_ )
+        if ( w->arena ) bytes += w->arena->bytesInUse();
+    return bytes;
+}
+
 #endif
 
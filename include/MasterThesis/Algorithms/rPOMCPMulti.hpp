@@ -0,0 +1,32 @@
+#ifndef MASTER_THESIS_rPOMCP_MULTI_HEADER_FILE
+#define MASTER_THESIS_rPOMCP_MULTI_HEADER_FILE
+
+#include <MasterThesis/Algorithms/rPOMCP.hpp>
+
+/**
+ * @brief The rPOMCP online planner for multiple targets.
+ *
+ * Tracking each target with its own rPOMCP means building one tree per
+ * target, all planning over the same actions, and combining them only at
+ * the root. Here instead all targets share a single tree. Each simulation
+ * samples a state for every target, and moves all of them with the same
+ * actions; the belief nodes keep a particle belief for each target, and
+ * their reward is the sum of the knowledge measures of all targets. The
+ * simulations needed for each decision are then shared, rather than
+ * multiplied by the number of targets.
+ *
+ * This is rPOMCPCore with the MultiTarget policy (see Targets.hpp), so it
+ * is constructed with one, as in:
+ *
+ *     rPOMCPMulti<M>(model, MultiTarget(model, targets), beliefSize, iterations, exp)
+ *
+ * and is rerooted with one observation per target.
+ *
+ * @tparam M The generative model of a single target, which is sampled once for each of them.
+ * @tparam K The knowledge measure used as reward of the beliefs of each target (see KnowledgeMeasures.hpp).
+ * @tparam E The evaluator of the new leaves of the tree (see LeafEvaluators.hpp).
+ */
+template <typename M, typename K = Entropy, typename E = FixedHeuristic>
+using rPOMCPMulti = rPOMCPCore<M, K, E, UCBRoot, MultiTarget>;
+
+#endif
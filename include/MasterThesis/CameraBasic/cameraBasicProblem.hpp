@@ -5,13 +5,22 @@
 #include <tuple>
 #include <random>
 #include <array>
+#include <vector>
+#include <utility>
 
 #include <iostream>
 
+#include <MasterThesis/Random.hpp>
+
 class CameraBasicModel {
     public:
         enum { UP = 0, RIGHT = 1, DOWN = 2, LEFT = 3 };
 
+        // This is the cell a target moving with sampleSR is walking to.
+        struct Goal {
+            unsigned x, y;
+        };
+
         CameraBasicModel(unsigned gridSize, double discount);
 
         size_t getS() const;
@@ -19,6 +28,9 @@ class CameraBasicModel {
         size_t getO() const;
         double getDiscount() const;
         std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t) const;
+        // This version only uses the provided generator, so that multiple
+        // threads can sample the model at the same time.
+        std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t, RandomEngine &) const;
 
         // In this class we use sampleSR in order to produce trajectories
         // which are not actually sampled from the true model distribution.
@@ -27,10 +39,15 @@ class CameraBasicModel {
         // model for the targets, which makes somewhat sense, but to have
         // targets move non-randomly, which also makes sense.
         std::tuple<size_t, double> sampleSR(size_t, size_t) const;
+        // These only use the provided goal and generator, so that each
+        // trajectory can have its own, and multiple threads can make them.
+        Goal sampleGoal(RandomEngine &) const;
+        std::tuple<size_t, double> sampleSR(size_t, size_t, Goal &, RandomEngine &) const;
 
         bool isTerminal(size_t) const;
 
         std::tuple<size_t, double> sampleOR(size_t,size_t, size_t) const;
+        std::tuple<size_t, double> sampleOR(size_t,size_t, size_t, RandomEngine &) const;
 
         inline size_t coordToState(unsigned x, unsigned y) const {
             return static_cast<size_t>(x + gridSize_ * y);
@@ -43,6 +60,11 @@ class CameraBasicModel {
 
         double getTransitionProbability(size_t, size_t, size_t) const;
         double getObservationProbability(size_t, size_t, size_t) const;
+        // These list the states and observations with non-zero probability,
+        // so that beliefs can be updated without going through all pairs of
+        // states (see is_sparse_model).
+        void getSuccessors(size_t, size_t, std::vector<std::pair<size_t, double>> &) const;
+        void getObservations(size_t, size_t, std::vector<std::pair<size_t, double>> &) const;
         // Unused
         double getExpectedReward(size_t, size_t, size_t) const;
 
@@ -53,16 +75,19 @@ class CameraBasicModel {
         // is using
         size_t getTrueState(size_t s) const { return s; }
     private:
-        size_t sampleTransition(size_t) const;
+        size_t sampleTransition(size_t, RandomEngine &) const;
         // This is the function that creates non-fully-random transitions
         // to make targets move in a believable fashion. The idea is to
         // make each target select a random cell and go there. When he arrives,
         // he selects a new target and so on.
-        size_t sampleTrajectoryTransition(size_t) const;
-        size_t sampleObservation(size_t, size_t) const;
+        size_t sampleTrajectoryTransition(size_t, Goal &, RandomEngine &) const;
+        size_t sampleObservation(size_t, size_t, RandomEngine &) const;
 
         size_t getNextDirState(size_t, unsigned) const;
         size_t checkCameraField(size_t, size_t) const;
+        // This computes what getNextDirState returns; it is used to fill
+        // the neighbour table.
+        size_t computeNextDirState(size_t, unsigned) const;
 
         unsigned gridSize_, gridCells_;
         size_t entranceA_, entranceB_;
@@ -70,10 +95,17 @@ class CameraBasicModel {
         unsigned cameraSize_;
         std::vector<std::array<unsigned, 4>> cameraData; // Observed count, x1, y1, width
 
+        // These are filled at construction, so that moving targets and
+        // checking cameras are just lookups.
+        std::vector<std::array<unsigned, 4>> neighbours_;  // Next state for each direction, per cell
+        std::vector<std::array<unsigned, 2>> cellCameras_; // Camera seeing the cell, position under it
+
         size_t S, A;
         double discount_;
 
-        mutable std::default_random_engine rand_;
+        // These are only used by the overloads without a generator.
+        mutable RandomEngine rand_;
+        mutable Goal goal_;
 };
 
 #endif
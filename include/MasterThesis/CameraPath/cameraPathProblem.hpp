@@ -5,9 +5,13 @@
 #include <tuple>
 #include <random>
 #include <array>
+#include <vector>
+#include <utility>
 
 #include <iostream>
 
+#include <MasterThesis/Random.hpp>
+
 // In this model we multiply the statespace of the CameraBasicModel
 // by four. In this way we can track the way a target is moving, and
 // assume that if it was moving in a particular direction, than it is
@@ -19,6 +23,11 @@ class CameraPathModel {
     public:
         enum { UP = 0, RIGHT = 1, DOWN = 2, LEFT = 3 };
 
+        // This is the cell a target moving with sampleSR is walking to.
+        struct Goal {
+            unsigned x, y;
+        };
+
         CameraPathModel(unsigned gridSize, double discount);
 
         size_t getS() const;
@@ -26,6 +35,12 @@ class CameraPathModel {
         size_t getO() const;
         double getDiscount() const;
         std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t) const;
+        // This version only uses the provided generator, so that multiple
+        // threads can sample the model at the same time.
+        std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t, RandomEngine &) const;
+        // This samples many state-action pairs at once, for planners which
+        // advance many simulations together.
+        void sampleSORBatch(const std::vector<size_t> &, const std::vector<size_t> &, std::vector<std::tuple<size_t, size_t, double>> &, RandomEngine &) const;
 
         // In this class we use sampleSR in order to produce trajectories
         // which are not actually sampled from the true model distribution.
@@ -34,10 +49,15 @@ class CameraPathModel {
         // model for the targets, which makes somewhat sense, but to have
         // targets move non-randomly, which also makes sense.
         std::tuple<size_t, double> sampleSR(size_t, size_t) const;
+        // These only use the provided goal and generator, so that each
+        // trajectory can have its own, and multiple threads can make them.
+        Goal sampleGoal(RandomEngine &) const;
+        std::tuple<size_t, double> sampleSR(size_t, size_t, Goal &, RandomEngine &) const;
 
         bool isTerminal(size_t) const;
 
         std::tuple<size_t, double> sampleOR(size_t,size_t, size_t) const;
+        std::tuple<size_t, double> sampleOR(size_t,size_t, size_t, RandomEngine &) const;
 
         inline size_t coordToState(unsigned x, unsigned y) const {
             return static_cast<size_t>(x + gridSize_ * y);
@@ -50,6 +70,11 @@ class CameraPathModel {
 
         double getTransitionProbability(size_t, size_t, size_t) const;
         double getObservationProbability(size_t, size_t, size_t) const;
+        // These list the states and observations with non-zero probability,
+        // so that beliefs can be updated without going through all pairs of
+        // states (see is_sparse_model).
+        void getSuccessors(size_t, size_t, std::vector<std::pair<size_t, double>> &) const;
+        void getObservations(size_t, size_t, std::vector<std::pair<size_t, double>> &) const;
         // Unused
         double getExpectedReward(size_t, size_t, size_t) const;
 
@@ -59,13 +84,16 @@ class CameraPathModel {
         // position, not target + direction.
         size_t getTrueState(size_t s) const { return convertToNormalState(s); }
     private:
-        size_t sampleTransition(size_t) const;
+        size_t sampleTransition(size_t, RandomEngine &) const;
         // This is the function that creates non-fully-random transitions
         // to make targets move in a believable fashion. The idea is to
         // make each target select a random cell and go there. When he arrives,
         // he selects a new target and so on.
-        size_t sampleTrajectoryTransition(size_t) const;
-        size_t sampleObservation(size_t, size_t) const;
+        size_t sampleTrajectoryTransition(size_t, Goal &, RandomEngine &) const;
+        size_t sampleObservation(size_t, size_t, RandomEngine &) const;
+        // This adds the camera noise to the position of the target under
+        // the camera, as computed by checkCameraField.
+        size_t sampleCameraNoise(size_t, size_t, size_t, RandomEngine &) const;
 
         // This function tells us which is the preferred direction
         // that a target wants to move.
@@ -73,9 +101,14 @@ class CameraPathModel {
         // This function removes the preferred part from the state
         // to keep previous code.
         size_t convertToNormalState(size_t) const;
+        // This maps the actions to the cameras actually used.
+        size_t convertAction(size_t) const;
 
         size_t getNextDirState(size_t, unsigned) const;
         size_t checkCameraField(size_t, size_t) const;
+        // This computes what getNextDirState returns; it is used to fill
+        // the neighbour table.
+        size_t computeNextDirState(size_t, unsigned) const;
 
         unsigned gridSize_, gridCells_;
         size_t entranceA_, entranceB_;
@@ -83,10 +116,17 @@ class CameraPathModel {
         unsigned cameraSize_;
         std::vector<std::array<unsigned, 4>> cameraData; // Observed count, x1, y1, width
 
+        // These are filled at construction, so that moving targets and
+        // checking cameras are just lookups.
+        std::vector<std::array<unsigned, 4>> neighbours_;  // Next state for each direction, per cell
+        std::vector<std::array<unsigned, 2>> cellCameras_; // Camera seeing the cell, position under it
+
         size_t S, A;
         double discount_;
 
-        mutable std::default_random_engine rand_;
+        // These are only used by the overloads without a generator.
+        mutable RandomEngine rand_;
+        mutable Goal goal_;
 };
 
 #endif
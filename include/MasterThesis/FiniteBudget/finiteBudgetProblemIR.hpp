@@ -8,6 +8,8 @@
 
 #include <iostream>
 
+#include <MasterThesis/Random.hpp>
+
 class FiniteBudgetModelIR {
     public:
         FiniteBudgetModelIR(unsigned worldWidth, double leftP, size_t maxBudget, double discount);
@@ -17,8 +19,12 @@ class FiniteBudgetModelIR {
         size_t getO() const;
         double getDiscount() const;
         std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t) const;
+        // These versions only use the provided generator, so that multiple
+        // threads can sample the model at the same time.
+        std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t, RandomEngine &) const;
 
         std::tuple<size_t, double> sampleOR(size_t,size_t, size_t) const;
+        std::tuple<size_t, double> sampleOR(size_t,size_t, size_t, RandomEngine &) const;
         // In this class we use sampleSR in order to produce trajectories
         // which are not actually sampled from the true model distribution.
         // This works because sampleSR is not used anywhere else but to
@@ -26,6 +32,7 @@ class FiniteBudgetModelIR {
         // model for the targets, which makes somewhat sense, but to have
         // targets move non-randomly, which also makes sense.
         std::tuple<size_t, double> sampleSR(size_t, size_t) const;
+        std::tuple<size_t, double> sampleSR(size_t, size_t, RandomEngine &) const;
 
         double getTransitionProbability(size_t, size_t, size_t) const;
         double getObservationProbability(size_t, size_t, size_t) const;
@@ -58,13 +65,13 @@ class FiniteBudgetModelIR {
 
         bool isTerminal(size_t) const;
     private:
-        size_t sampleTransition(size_t) const;
+        size_t sampleTransition(size_t, RandomEngine &) const;
         // This is the function that creates non-fully-random transitions
         // to make targets move in a believable fashion. The idea is to
         // make each target select a random cell and go there. When he arrives,
         // he selects a new target and so on.
-        size_t sampleTrajectoryTransition(size_t) const;
-        size_t sampleObservation(size_t, size_t) const;
+        size_t sampleTrajectoryTransition(size_t, RandomEngine &) const;
+        size_t sampleObservation(size_t, size_t, RandomEngine &) const;
 
         size_t makeState(size_t s, size_t budget) const;
 
@@ -75,7 +82,8 @@ class FiniteBudgetModelIR {
 
         double cameraPrecision_, leftProbability_;
 
-        mutable std::default_random_engine rand_;
+        // This is only used by the overloads without a generator.
+        mutable RandomEngine rand_;
 };
 
 #endif
@@ -5,6 +5,8 @@
 #include <tuple>
 #include <random>
 
+#include <MasterThesis/Random.hpp>
+
 class MyopicModelIR {
     public:
         MyopicModelIR(size_t size, double discount);
@@ -15,7 +17,11 @@ class MyopicModelIR {
         double getDiscount() const;
 
         std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t) const;
+        // These versions only use the provided generator, so that multiple
+        // threads can sample the model at the same time.
+        std::tuple<size_t, size_t, double> sampleSOR(size_t, size_t, RandomEngine &) const;
         std::tuple<size_t, double> sampleSR(size_t, size_t) const;
+        std::tuple<size_t, double> sampleSR(size_t, size_t, RandomEngine &) const;
         bool isTerminal(size_t) const;
 
         double getTransitionProbability(size_t, size_t, size_t) const;
@@ -23,6 +29,7 @@ class MyopicModelIR {
         double getExpectedReward(size_t, size_t, size_t) const;
 
         std::tuple<size_t, double> sampleOR(size_t,size_t, size_t) const;
+        std::tuple<size_t, double> sampleOR(size_t,size_t, size_t, RandomEngine &) const;
 
         std::pair<size_t, size_t> decodeAction(size_t) const;
         size_t encodeAction(size_t, size_t) const;
@@ -32,13 +39,14 @@ class MyopicModelIR {
         // is using
         size_t getTrueState(size_t s) const { return s; }
     private:
-        size_t sampleTransition(size_t) const;
-        size_t sampleObservation(size_t, size_t) const;
+        size_t sampleTransition(size_t, RandomEngine &) const;
+        size_t sampleObservation(size_t, size_t, RandomEngine &) const;
 
         size_t size_, S, A;
         double discount_;
 
-        mutable std::default_random_engine rand_;
+        // This is only used by the overloads without a generator.
+        mutable RandomEngine rand_;
 };
 
 #endif
@@ -0,0 +1,182 @@
+#ifndef MASTER_THESIS_RANDOM_HEADER_FILE
+#define MASTER_THESIS_RANDOM_HEADER_FILE
+
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+#include <AIToolbox/Impl/Seeder.hpp>
+
+/**
+ * @brief This function scrambles the input into a well mixed 64 bit value.
+ *
+ * This is the output function of the SplitMix64 generator. Its main use is to
+ * turn seeds which are close together (as a counter) into unrelated ones.
+ */
+inline uint64_t mixSeed(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief This class is the xoshiro256** random generator.
+ *
+ * It is considerably faster than std::default_random_engine, and returns 64
+ * random bits per call rather than 31, so that a double can be sampled with
+ * a single call. It satisfies the UniformRandomBitGenerator requirements, so
+ * it can be used with all standard distributions.
+ */
+class FastRandomEngine {
+    public:
+        using result_type = uint64_t;
+
+        explicit FastRandomEngine(result_type seed = 0) { this->seed(seed); }
+
+        void seed(result_type seed) {
+            // The state is filled with SplitMix64 as recommended, so that it
+            // is never all zeroes.
+            for ( auto & s : s_ ) {
+                s = mixSeed(seed);
+                seed += 0x9e3779b97f4a7c15ULL;
+            }
+        }
+
+        result_type operator()() {
+            const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+            const uint64_t t = s_[1] << 17;
+
+            s_[2] ^= s_[0];
+            s_[3] ^= s_[1];
+            s_[1] ^= s_[2];
+            s_[0] ^= s_[3];
+
+            s_[2] ^= t;
+            s_[3] = rotl(s_[3], 45);
+
+            return result;
+        }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        bool operator==(const FastRandomEngine & other) const {
+            return s_[0] == other.s_[0] && s_[1] == other.s_[1] && s_[2] == other.s_[2] && s_[3] == other.s_[3];
+        }
+        bool operator!=(const FastRandomEngine & other) const { return !(*this == other); }
+
+    private:
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t s_[4];
+};
+
+// This is the generator used by the models and planners while sampling.
+using RandomEngine = FastRandomEngine;
+
+/**
+ * @brief This class hands out the seeds of all random generators.
+ *
+ * By default seeds come from AIToolbox::Impl::Seeder, so that each run is
+ * different. Once a master seed is set, every seed is instead derived from
+ * it, so that a run can be replayed exactly.
+ *
+ * Seeds can be requested in two ways. getSeed() returns the next seed of a
+ * single sequence, which is reproducible as long as the components asking for
+ * them are created in the same order. getSeed(stream, substream) returns a
+ * seed which only depends on its arguments; it is meant for components which
+ * are created concurrently, as one stream per thread. Seeds of different
+ * streams are unrelated, so the generators they seed are independent.
+ *
+ * All functions are thread-safe.
+ */
+class RandomStreams {
+    public:
+        /**
+         * @brief This function sets the seed from which all following seeds are derived.
+         *
+         * It should be called before creating any model or planner, as
+         * those seed their generators on construction.
+         *
+         * @param seed The master seed.
+         */
+        static void setMasterSeed(uint64_t seed) {
+            auto & s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.base = mixSeed(seed);
+            s.counter = 0;
+            s.master = s.hasBase = true;
+        }
+
+        /**
+         * @brief This function sets the master seed from an environment variable, if it is set.
+         *
+         * @param name The name of the variable to read.
+         *
+         * @return True if the variable was set, false otherwise.
+         */
+        static bool setMasterSeedFromEnvironment(const char * name = "SEED") {
+            const char * value = std::getenv(name);
+            if ( !value ) return false;
+            setMasterSeed(std::stoull(value));
+            return true;
+        }
+
+        /**
+         * @brief This function returns whether a master seed has been set.
+         */
+        static bool hasMasterSeed() {
+            auto & s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            return s.master;
+        }
+
+        /**
+         * @brief This function returns the next seed of the main sequence.
+         */
+        static uint64_t getSeed() {
+            auto & s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if ( !s.master )
+                return (uint64_t(AIToolbox::Impl::Seeder::getSeed()) << 32) ^ AIToolbox::Impl::Seeder::getSeed();
+            return mixSeed(s.base + s.counter++);
+        }
+
+        /**
+         * @brief This function returns the seed of the specified stream.
+         *
+         * @param stream The stream, for example the index of a component.
+         * @param substream The substream, for example the index of a thread.
+         *
+         * @return A seed which only depends on the master seed and the inputs.
+         */
+        static uint64_t getSeed(uint64_t stream, uint64_t substream = 0) {
+            auto & s = state();
+            std::unique_lock<std::mutex> lock(s.mutex);
+            if ( !s.hasBase ) {
+                // We draw a random base once, so that streams are still
+                // distinct from each other within a run.
+                s.base = (uint64_t(AIToolbox::Impl::Seeder::getSeed()) << 32) ^ AIToolbox::Impl::Seeder::getSeed();
+                s.hasBase = true;
+            }
+            const uint64_t base = s.base;
+            lock.unlock();
+            return mixSeed(mixSeed(base ^ mixSeed(stream)) + substream);
+        }
+
+    private:
+        struct State {
+            std::mutex mutex;
+            uint64_t base = 0, counter = 0;
+            bool master = false, hasBase = false;
+        };
+
+        static State & state() {
+            static State s;
+            return s;
+        }
+};
+
+#endif
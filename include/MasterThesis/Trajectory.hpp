@@ -1,24 +1,62 @@
 #ifndef MASTER_THESIS_TRAJECTORY_HEADER_FILE
 #define MASTER_THESIS_TRAJECTORY_HEADER_FILE
 
-#include <AIToolbox/Impl/Seeder.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
+#include <AIToolbox/ProbabilityUtils.hpp>
 
+#include <MasterThesis/Random.hpp>
+
+// This checks whether the model walks its trajectories towards a goal which
+// has to be carried from one sampleSR call to the next.
+template <typename M>
+struct has_trajectory_goal {
+    private:
+        template <typename Z> static auto test(int) -> decltype(typename Z::Goal(), std::true_type());
+        template <typename Z> static auto test(...) -> std::false_type;
+
+    public:
+        enum { value = std::is_same<decltype(test<M>(0)),std::true_type>::value };
+};
+
+template <typename M>
+size_t sampleTrajectory(const M& model, size_t state, unsigned horizon, std::vector<size_t> & traj, RandomEngine & rand, std::true_type) {
+    auto goal = model.sampleGoal(rand);
+    for ( unsigned i = 0; i < horizon+1; ++i ) {
+        traj.push_back(state);
+        std::tie(state, std::ignore) = model.sampleSR(state, 0, goal, rand);
+    }
+    return state;
+}
+
+template <typename M>
+size_t sampleTrajectory(const M& model, size_t state, unsigned horizon, std::vector<size_t> & traj, RandomEngine & rand, std::false_type) {
+    for ( unsigned i = 0; i < horizon+1; ++i ) {
+        traj.push_back(state);
+        std::tie(state, std::ignore) = model.sampleSR(state, 0, rand);
+    }
+    return state;
+}
+
+// This version only uses the provided generator, so that trajectories can be
+// generated from multiple threads on the same model.
 template <typename M, typename std::enable_if<AIToolbox::MDP::is_generative_model<M>::value, int>::type = 0>
-std::vector<size_t> makeTrajectory(const M& model, unsigned horizon, const AIToolbox::POMDP::Belief & b) {
+std::vector<size_t> makeTrajectory(const M& model, unsigned horizon, const AIToolbox::POMDP::Belief & b, RandomEngine & rand) {
     using namespace AIToolbox;
-    static std::default_random_engine rand(Impl::Seeder::getSeed());
 
     std::vector<size_t> traj;
-    traj.reserve(horizon);
+    traj.reserve(horizon+1);
 
     size_t state = sampleProbability(model.getS(), b, rand);
-    for ( unsigned i = 0; i < horizon+1; ++i ) {
-        traj.push_back(state);
-        std::tie(state, std::ignore) = model.sampleSR(state, 0);
-    }
+    sampleTrajectory(model, state, horizon, traj, rand, std::integral_constant<bool, has_trajectory_goal<M>::value>());
 
     return traj;
 }
 
+template <typename M, typename std::enable_if<AIToolbox::MDP::is_generative_model<M>::value, int>::type = 0>
+std::vector<size_t> makeTrajectory(const M& model, unsigned horizon, const AIToolbox::POMDP::Belief & b) {
+    static RandomEngine rand(RandomStreams::getSeed());
+
+    return makeTrajectory(model, horizon, b, rand);
+}
+
 #endif
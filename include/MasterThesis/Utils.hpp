@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <type_traits>
+#include <iostream>
 
 template <typename Solver, typename = typename std::enable_if<std::is_same<size_t, decltype(((Solver*)nullptr)->getGuess())>::value>::type>
 constexpr bool isSolverIR(int, const Solver &) {
@@ -24,4 +25,26 @@ double ifNotIRGuess(double r, double, const S &, const M& ) {
     return r;
 }
 
+// This returns the name of the knowledge measure the solver uses as reward,
+// or nullptr if the solver uses the reward of the model.
+template <typename Solver, typename = typename Solver::Knowledge>
+const char * getKnowledgeName(int, const Solver &) {
+    return Solver::Knowledge::name();
+}
+
+template <typename S>
+const char * getKnowledgeName(double, const S &) {
+    return nullptr;
+}
+
+// This prints how many times the solver had to restart from a uniform
+// belief, for solvers which keep track of it.
+template <typename Solver, typename = decltype(((Solver*)nullptr)->getFallbacks())>
+void printFallbacks(int, const Solver & solver) {
+    std::cout << "\nRestarts from uniform belief: " << solver.getFallbacks() << '\n';
+}
+
+template <typename S>
+void printFallbacks(double, const S &) {}
+
 #endif
@@ -2,11 +2,11 @@
 #define MASTER_THESIS_MAKE_EXPERIMENT_POMCP_HEADER_FILE
 
 #include <AIToolbox/POMDP/Types.hpp>
-#include <AIToolbox/Impl/Seeder.hpp>
 #include <AIToolbox/ProbabilityUtils.hpp>
 
 #include <MasterThesis/IO.hpp>
 #include <MasterThesis/Utils.hpp>
+#include <MasterThesis/Random.hpp>
 #include <MasterThesis/Signals.hpp>
 #include <MasterThesis/Trajectory.hpp>
 
@@ -39,7 +39,7 @@ void makeExperimentPOMCP(
                     unsigned solverHorizon,        Solver & solver,   const ap::Belief & solverBelief,
                     const std::string & outputFilename, bool useTrajectory = false )
 {
-    static std::default_random_engine rand(AIToolbox::Impl::Seeder::getSeed());
+    static RandomEngine rand(RandomStreams::getSeed());
 
     double totalReward = 0.0;
     std::vector<double> timestepTotalReward(modelHorizon, 0.0);
@@ -57,11 +57,9 @@ void makeExperimentPOMCP(
     else
         std::cout << "Using guess reward";
 
-#ifdef ENTROPY
-            std::cout << " and ENTROPY\n";
-#else
-            std::cout << " and MAX OF BELIEF\n";
-#endif
+    if ( auto knowledge = getKnowledgeName(1, solver) )
+        std::cout << " and " << knowledge;
+    std::cout << '\n';
 
     std::cout << "Initial Belief: " << printBelief(modelBelief)  << '\n';
     std::cout << "Solver  Belief: " << printBelief(solverBelief) << '\n';
@@ -124,6 +122,7 @@ void makeExperimentPOMCP(
             gnuplotCumulativeSave(timestepTotalReward, outputFilename, experiment);
     }
     gnuplotCumulativeSave(timestepTotalReward, outputFilename, std::min(experiment, numExperiments));
+    printFallbacks(1, solver);
 }
 
 #endif
@@ -2,12 +2,13 @@
 #define MASTER_THESIS_MAKE_EXPERIMENT_RTBSS_HEADER_FILE
 
 #include <AIToolbox/POMDP/Types.hpp>
-#include <AIToolbox/Impl/Seeder.hpp>
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/POMDP/Utils.hpp>
 
 #include <MasterThesis/IO.hpp>
 #include <MasterThesis/Utils.hpp>
+#include <MasterThesis/Random.hpp>
+#include <MasterThesis/Algorithms/Utils/SparseBelief.hpp>
 #include <MasterThesis/Signals.hpp>
 
 #include <random>
@@ -40,7 +41,7 @@ void makeExperimentRTBSS(
                     unsigned solverHorizon,        Solver & solver,         ap::Belief   solverBelief,
                     const std::string & outputFilename, bool useTrajectory = false )
 {
-    static std::default_random_engine rand(AIToolbox::Impl::Seeder::getSeed());
+    static RandomEngine rand(RandomStreams::getSeed());
 
     double totalReward = 0.0;
     std::vector<double> timestepTotalReward(modelHorizon, 0.0);
@@ -58,11 +59,9 @@ void makeExperimentRTBSS(
     else
         std::cout << "Using guess reward";
 
-#ifdef ENTROPY
-            std::cout << " and ENTROPY\n";
-#else
-            std::cout << " and MAX OF BELIEF\n";
-#endif
+    if ( auto knowledge = getKnowledgeName(1, solver) )
+        std::cout << " and " << knowledge;
+    std::cout << '\n';
 
     std::cout << "Initial Belief: " << printBelief(modelBelief)  << '\n';
     std::cout << "Solver  Belief: " << printBelief(solverBelief) << '\n';
@@ -122,7 +121,7 @@ void makeExperimentRTBSS(
             // Update states
             s = s1;
             // Update belief
-            solverBelief = ap::updateBelief(model, solverBelief, a, o);
+            solverBelief = sparseUpdateBelief(model, solverBelief, a, o);
         }
         if ( processInterrupted ) break;
         if ( ! (experiment % 100) )
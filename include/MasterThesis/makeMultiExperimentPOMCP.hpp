@@ -2,11 +2,14 @@
 #define MASTER_THESIS_MAKE_MULTI_EXPERIMENT_POMCP_HEADER_FILE
 
 #include <AIToolbox/POMDP/Types.hpp>
-#include <AIToolbox/Impl/Seeder.hpp>
 #include <AIToolbox/ProbabilityUtils.hpp>
 
 #include <MasterThesis/IO.hpp>
 #include <MasterThesis/Signals.hpp>
+#include <MasterThesis/Random.hpp>
+#include <MasterThesis/Algorithms/Utils/ModelTraits.hpp>
+#include <MasterThesis/Algorithms/Utils/ThreadPool.hpp>
+#include <MasterThesis/Algorithms/rPOMCPMulti.hpp>
 
 #include <cstddef>
 #include <vector>
@@ -15,6 +18,7 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <type_traits>
 
 namespace ap = AIToolbox::POMDP;
 
@@ -26,20 +30,77 @@ size_t extractAction(const std::vector<POMCP> & solvers) {
 
     for ( const auto & solver : solvers ) {
         for ( size_t a = 0; a < A; ++a )
-            values[a] += solver.getGraph().children[a].V;
+            values[a] += solver.getGraph().stats.V[a];
     }
     auto x = std::distance(std::begin(values), std::max_element(std::begin(values), std::end(values)));
     return x;
 }
 
-template <typename Model, typename Solver>
+// These plan a step for all targets and return the action to take, either
+// with a solver per target or with a single solver tracking all of them. A
+// single solver does not use the pool.
+template <typename Solver>
+size_t planTargets(std::vector<Solver> & solvers, ThreadPool & pool, const ap::Belief & b, unsigned horizon) {
+    pool.parallelFor(solvers.size(), [&](unsigned p) {
+        solvers[p].sampleAction(b, horizon);
+    });
+    return extractAction(solvers);
+}
+
+template <typename Solver>
+size_t planTargets(std::vector<Solver> & solvers, ThreadPool & pool, size_t a, const std::vector<size_t> & obs, unsigned horizon) {
+    pool.parallelFor(solvers.size(), [&](unsigned p) {
+        solvers[p].sampleAction(a, obs[p], horizon);
+    });
+    return extractAction(solvers);
+}
+
+template <typename Solver>
+size_t guessTarget(const std::vector<Solver> & solvers, unsigned p) {
+    return solvers[p].getGuess();
+}
+
+template <typename M, typename K, typename E, typename R>
+size_t planTargets(rPOMCPCore<M, K, E, R, MultiTarget> & solver, ThreadPool &, const ap::Belief & b, unsigned horizon) {
+    return solver.sampleAction(b, horizon);
+}
+
+template <typename M, typename K, typename E, typename R>
+size_t planTargets(rPOMCPCore<M, K, E, R, MultiTarget> & solver, ThreadPool &, size_t a, const std::vector<size_t> & obs, unsigned horizon) {
+    return solver.sampleAction(a, obs, horizon);
+}
+
+template <typename M, typename K, typename E, typename R>
+size_t guessTarget(const rPOMCPCore<M, K, E, R, MultiTarget> & solver, unsigned p) {
+    return solver.getGuess(p);
+}
+
+// This tells whether the solvers of the targets sample the model only with
+// their own generators. Only rPOMCP does; AIToolbox's POMCP samples with the
+// generator of the model itself.
+template <typename Solvers>
+struct samples_with_own_generator : std::false_type {};
+
+template <typename M, typename K, typename E, typename R, typename P>
+struct samples_with_own_generator<std::vector<rPOMCPCore<M, K, E, R, P>>> : std::true_type {};
+
+// The solvers of the targets are independent, so each step they can plan
+// on different threads. They all share the model, so this is only done if
+// each solver samples with its own generator, and the model can be sampled
+// concurrently (see is_reentrant_generative_model).
+//
+// Solvers is either a vector with a solver per target, or an rPOMCPMulti.
+template <typename Model, typename Solvers>
 void makeMultiExperimentPOMCP(
                     unsigned numExperiments, unsigned numTargets,
                     unsigned modelHorizon,   const Model  & model,            const ap::Belief & modelBelief,
-                    unsigned solverHorizon,  std::vector<Solver> & solvers,   const ap::Belief & solverBelief,
-                    const std::string & outputFilename, bool useTrajectory = false )
+                    unsigned solverHorizon,  Solvers & solvers,               const ap::Belief & solverBelief,
+                    const std::string & outputFilename, bool useTrajectory = false, unsigned threads = 1 )
 {
-    static std::default_random_engine rand(AIToolbox::Impl::Seeder::getSeed());
+    static RandomEngine rand(RandomStreams::getSeed());
+
+    const bool parallel = is_reentrant_generative_model<Model>::value && samples_with_own_generator<Solvers>::value;
+    ThreadPool pool(parallel ? std::max(1u, std::min(threads, numTargets)) : 1u);
 
     double totalReward = 0.0;
     std::vector<double> timestepTotalReward(modelHorizon, 0.0);
@@ -54,13 +115,10 @@ void makeMultiExperimentPOMCP(
 
     unsigned experiment = 1;
     for ( ; experiment <= numExperiments; ++experiment ) {
-        // Run pomcp, but don't get actions yet
-        for ( unsigned p = 0; p < numTargets; ++p ) {
+        for ( unsigned p = 0; p < numTargets; ++p )
             pos[p] = AIToolbox::sampleProbability(model.getS(), modelBelief, rand);
-            solvers[p].sampleAction(solverBelief, std::min(solverHorizon, modelHorizon));
-        }
-        // Extract action
-        size_t a = extractAction(solvers);
+        // Run pomcp and extract action
+        size_t a = planTargets(solvers, pool, solverBelief, std::min(solverHorizon, modelHorizon));
 
         std::vector<std::vector<size_t>> trajectories;
         if ( useTrajectory ) {
@@ -74,7 +132,7 @@ void makeMultiExperimentPOMCP(
 #endif
             // Extract observations and rewards, and update positions of targets.
             for ( unsigned p = 0; p < numTargets; ++p ) {
-                rew += ( model.getTrueState(solvers[p].getGuess()) == model.getTrueState(pos[p]) );
+                rew += ( model.getTrueState(guessTarget(solvers, p)) == model.getTrueState(pos[p]) );
 
                 if ( useTrajectory ) {
                     pos[p] = trajectories[p][i];
@@ -103,10 +161,7 @@ void makeMultiExperimentPOMCP(
             std::cout << '\r'               << std::flush;
 #endif
 
-            for ( unsigned p = 0; p < numTargets; ++p )
-                solvers[p].sampleAction(a, obs[p], std::min(solverHorizon, modelHorizon - i));
-
-            a = extractAction(solvers);
+            a = planTargets(solvers, pool, a, obs, std::min(solverHorizon, modelHorizon - i));
         }
         if ( processInterrupted ) break;
         if ( ! (experiment % 100) )
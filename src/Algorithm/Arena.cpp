@@ -0,0 +1,110 @@
+#include <MasterThesis/Algorithms/Utils/Arena.hpp>
+
+#include <mutex>
+
+thread_local unsigned Arena::currentLane_ = 0;
+
+Arena::Lane::Lane(unsigned lane) : previous_(currentLane_) {
+    currentLane_ = lane;
+}
+
+Arena::Lane::~Lane() {
+    currentLane_ = previous_;
+}
+
+Arena::Arena(unsigned lanes, size_t blockSize) : blockSize_(blockSize), lanes_(lanes ? lanes : 1), reserved_(0) {}
+
+Arena::~Arena() {
+    for ( auto & block : blocks_ )
+        ::operator delete(block.first);
+}
+
+void * Arena::allocate(size_t bytes) {
+    // Everything is rounded to the maximum alignment, so that every chunk
+    // can be reused for any type.
+    bytes = chunkSize(bytes);
+
+    auto & lane = getLane();
+    std::lock_guard<NodeLock> guard(lane.lock);
+    lane.inUse += bytes;
+
+    if ( bytes <= MaxSmall ) {
+        auto & list = lane.free[bytes / Align - 1];
+        if ( list ) {
+            void * p = list;
+            list = list->next;
+            return p;
+        }
+    }
+    // Big chunks get their own block, so we don't waste the current one.
+    if ( bytes > blockSize_ / 4 )
+        return newBlock(bytes);
+
+    if ( static_cast<size_t>(lane.end - lane.head) < bytes ) {
+        lane.head = newBlock(blockSize_);
+        lane.end  = lane.head + blockSize_;
+    }
+    void * p = lane.head;
+    lane.head += bytes;
+    return p;
+}
+
+void Arena::deallocate(void * p, size_t bytes) {
+    bytes = chunkSize(bytes);
+
+    auto & lane = getLane();
+    std::lock_guard<NodeLock> guard(lane.lock);
+    lane.inUse -= bytes;
+
+    // Big chunks are simply forgotten until the arena is released.
+    if ( bytes > MaxSmall ) return;
+
+    auto & list = lane.free[bytes / Align - 1];
+    list = new (p) FreeChunk{list};
+}
+
+void Arena::release() {
+    std::lock_guard<NodeLock> guard(blocksLock_);
+
+    // We keep the first block if it is a normal one, as we are likely to
+    // fill the arena up again. It goes to the first lane.
+    size_t keep = !blocks_.empty() && blocks_[0].second == blockSize_;
+    for ( size_t i = keep; i < blocks_.size(); ++i )
+        ::operator delete(blocks_[i].first);
+    blocks_.resize(keep);
+
+    for ( auto & lane : lanes_ ) {
+        lane.head = lane.end = nullptr;
+        lane.inUse = 0;
+        for ( auto & list : lane.free ) list = nullptr;
+    }
+    if ( keep ) {
+        lanes_[0].head = blocks_[0].first;
+        lanes_[0].end  = lanes_[0].head + blockSize_;
+    }
+    reserved_ = keep ? blockSize_ : 0;
+}
+
+size_t Arena::bytesInUse() const {
+    size_t inUse = 0;
+    for ( auto & lane : lanes_ )
+        inUse += lane.inUse;
+    return inUse;
+}
+
+size_t Arena::bytesReserved() const {
+    return reserved_;
+}
+
+auto Arena::getLane() -> LaneState & {
+    return lanes_[currentLane_ < lanes_.size() ? currentLane_ : 0];
+}
+
+char * Arena::newBlock(size_t bytes) {
+    char * block = static_cast<char*>(::operator new(bytes));
+
+    std::lock_guard<NodeLock> guard(blocksLock_);
+    blocks_.emplace_back(block, bytes);
+    reserved_ += bytes;
+    return block;
+}
@@ -0,0 +1,165 @@
+#include <MasterThesis/Algorithms/Utils/JointTreeNodes.hpp>
+
+template <typename K>
+JointBeliefNode<K>::JointBeliefNode(size_t targets, Arena & arena) : N(0), children(arena), stats(arena), V(0.0), actionsV(0.0), bestAction(0), maxMode(false),
+                                                                      trackBeliefs_(arena), knowledge_(targets, typename K::Knowledge(), arena)
+{
+    trackBeliefs_.reserve(targets);
+    for ( size_t t = 0; t < targets; ++t )
+        trackBeliefs_.emplace_back(arena);
+}
+
+template <typename K>
+JointBeliefNode<K>::JointBeliefNode(const JointBeliefNode & other, Arena & arena, unsigned minN, NodeCopies<JointBeliefNode> * copies) :
+                                                                                     N(other.N), children(arena), stats(other.stats, arena), V(other.V), actionsV(other.actionsV), bestAction(other.bestAction), maxMode(other.maxMode),
+                                                                                     trackBeliefs_(arena), knowledge_(other.knowledge_.begin(), other.knowledge_.end(), arena)
+{
+    trackBeliefs_.reserve(other.trackBeliefs_.size());
+    for ( auto & belief : other.trackBeliefs_ )
+        trackBeliefs_.emplace_back(belief, arena);
+
+    if ( copies ) ++copies->count;
+    if ( N < minN ) return;
+
+    children.reserve(other.children.size());
+    for ( auto & aNode : other.children )
+        children.emplace_back(aNode, arena, minN, copies);
+}
+
+template <typename K>
+void JointBeliefNode<K>::addActions(size_t A) {
+    if ( children.size() == A ) return;
+
+    Arena & arena = children.get_allocator().getArena();
+    children.reserve(A);
+    while ( children.size() < A )
+        children.emplace_back(arena);
+    stats.resize(A);
+}
+
+template <typename K>
+size_t JointBeliefNode<K>::getLeafBytes() const {
+    size_t bytes = Arena::chunkSize(sizeof(JointBeliefNode)) + stats.getCopyBytes() + Arena::vectorBytes(trackBeliefs_) + Arena::vectorBytes(knowledge_);
+    for ( auto & belief : trackBeliefs_ )
+        bytes += belief.getCopyBytes();
+    return bytes;
+}
+
+template <typename K>
+size_t JointBeliefNode<K>::getActionsBytes() const {
+    size_t bytes = Arena::vectorBytes(children);
+    for ( auto & aNode : children )
+        bytes += aNode.children.getCopyBytes();
+    return bytes;
+}
+
+template <typename K>
+JointActionNode<K>::JointActionNode(Arena & arena) : children(arena) {}
+
+template <typename K>
+JointActionNode<K>::JointActionNode(const JointActionNode & other, Arena & arena, unsigned minN, NodeCopies<JointBeliefNode<K>> * copies) : JointActionNode(arena) {
+    children.reserve(other.children.size());
+    for ( auto & pair : other.children ) {
+        const size_t key = copies && copies->rekey ? copies->rekey(pair.first) : pair.first;
+        if ( !copies || !copies->shared ) {
+            children[key] = arena.template make<JointBeliefNode<K>>(*pair.second, arena, minN, copies);
+            continue;
+        }
+        // References to unordered_map values survive the insertions done
+        // while copying the child.
+        auto & copy = copies->nodes[pair.second];
+        if ( !copy ) copy = arena.template make<JointBeliefNode<K>>(*pair.second, arena, minN, copies);
+        children[key] = copy;
+    }
+}
+
+template <typename K>
+JointHeadBeliefNode<K>::JointHeadBeliefNode(size_t targets, size_t A, Arena & arena) : JointBeliefNode<K>(targets, arena), visits(0), particles_(arena) {
+    this->addActions(A);
+    particles_.reserve(targets);
+    for ( size_t t = 0; t < targets; ++t )
+        particles_.emplace_back(arena);
+}
+
+template <typename K>
+JointHeadBeliefNode<K>::JointHeadBeliefNode(size_t targets, size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, Arena & arena, RandomEngine & rand) :
+                                                                                            JointHeadBeliefNode(targets, A, arena) {
+    for ( auto & particles : particles_ )
+        particles.assign(beliefSize, b, rand);
+}
+
+template <typename K>
+JointHeadBeliefNode<K>::JointHeadBeliefNode(size_t A, const JointBeliefNode<K> & bn, Arena & arena, RandomEngine &, NodeCopies<JointBeliefNode<K>> * copies) :
+                                                                                            JointBeliefNode<K>(bn, arena, 0, copies), visits(0), particles_(arena) {
+    this->addActions(A);
+    particles_.reserve(this->trackBeliefs_.size());
+    for ( auto & belief : this->trackBeliefs_ ) {
+        particles_.emplace_back(arena);
+        particles_.back().assign(belief);
+        belief.clear(); // Clear belief memory
+    }
+}
+
+template <typename K>
+JointHeadBeliefNode<K>::JointHeadBeliefNode(size_t A, const JointHeadBeliefNode & particles, Arena & arena, RandomEngine &) :
+                                                                                            JointBeliefNode<K>(particles.getTargets(), arena), visits(0), particles_(arena) {
+    this->addActions(A);
+    particles_.reserve(particles.particles_.size());
+    for ( auto & p : particles.particles_ )
+        particles_.emplace_back(p, arena);
+}
+
+template <typename K>
+JointHeadBeliefNode<K>::JointHeadBeliefNode(const JointHeadBeliefNode & other, Arena & arena, unsigned minN, NodeCopies<JointBeliefNode<K>> * copies) :
+                                                                                            JointBeliefNode<K>(other, arena, minN, copies), visits(other.visits), particles_(arena) {
+    particles_.reserve(other.particles_.size());
+    for ( auto & p : other.particles_ )
+        particles_.emplace_back(p, arena);
+}
+
+template <typename K>
+void JointHeadBeliefNode<K>::addParticles(const Particles & particles) {
+    for ( size_t t = 0; t < particles.size(); ++t )
+        particles_[t].add(particles[t]);
+}
+
+template <typename K>
+unsigned JointHeadBeliefNode<K>::refill(size_t beliefSize, const AIToolbox::POMDP::Belief & b, RandomEngine & rand) {
+    unsigned refilled = 0;
+    for ( auto & particles : particles_ ) {
+        if ( !particles.empty() ) continue;
+
+        particles.assign(beliefSize, b, rand);
+        ++refilled;
+    }
+    return refilled;
+}
+
+template <typename K>
+bool JointHeadBeliefNode<K>::isSampleBeliefEmpty(size_t target) const {
+    return particles_[target].empty();
+}
+
+template <typename K>
+void JointHeadBeliefNode<K>::sampleBelief(std::vector<size_t> & states, RandomEngine & rand) const {
+    for ( size_t t = 0; t < particles_.size(); ++t )
+        states[t] = particles_[t].sample(rand);
+}
+
+template <typename K>
+size_t JointHeadBeliefNode<K>::sampleBelief(size_t target, RandomEngine & rand) const {
+    return particles_[target].sample(rand);
+}
+
+template <typename K>
+size_t JointHeadBeliefNode<K>::getMostCommonParticle(size_t target) const {
+    return particles_[target].getMostCommon();
+}
+
+template class JointBeliefNode<Entropy>;
+template struct JointActionNode<Entropy>;
+template class JointHeadBeliefNode<Entropy>;
+
+template class JointBeliefNode<MaxBelief>;
+template struct JointActionNode<MaxBelief>;
+template class JointHeadBeliefNode<MaxBelief>;
@@ -0,0 +1,60 @@
+#include <MasterThesis/Algorithms/Utils/ThreadPool.hpp>
+
+ThreadPool::ThreadPool(unsigned size) : job_(nullptr), jobSize_(0), next_(0), remaining_(0), stop_(false) {
+    // The caller counts as a thread.
+    for ( unsigned i = 1; i < size; ++i )
+        helpers_.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for ( auto & t : helpers_ )
+        t.join();
+}
+
+void ThreadPool::parallelFor(unsigned n, const Job & job) {
+    if ( !n ) return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &job;
+    jobSize_ = n;
+    next_ = 0;
+    remaining_ = n;
+    wake_.notify_all();
+
+    runJobs(lock);
+
+    done_.wait(lock, [this]{ return remaining_ == 0; });
+    job_ = nullptr;
+}
+
+unsigned ThreadPool::size() const {
+    return helpers_.size() + 1;
+}
+
+void ThreadPool::work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( true ) {
+        wake_.wait(lock, [this]{ return stop_ || ( job_ && next_ < jobSize_ ); });
+        if ( stop_ ) return;
+
+        runJobs(lock);
+    }
+}
+
+void ThreadPool::runJobs(std::unique_lock<std::mutex> & lock) {
+    while ( job_ && next_ < jobSize_ ) {
+        unsigned i = next_++;
+        const Job & job = *job_;
+
+        lock.unlock();
+        job(i);
+        lock.lock();
+
+        if ( --remaining_ == 0 ) done_.notify_all();
+    }
+}
@@ -1,101 +1,170 @@
 #include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
 
 #include <iostream>
+#include <cstdint>
 
-BeliefNode::BeliefNode() : N(0), V(0.0), actionsV(0.0), bestAction(0), knowledgeMeasure_(0.0) {
-#ifndef ENTROPY
-    maxS_ = 0;
-#endif
+ActionStats::ActionStats(Arena & arena) : V(arena), N(arena), pending(arena) {}
+
+ActionStats::ActionStats(const ActionStats & other, Arena & arena) : V(other.V.begin(), other.V.end(), arena), N(other.N.begin(), other.N.end(), arena),
+                                                                     pending(other.pending.begin(), other.pending.end(), arena) {}
+
+void ActionStats::resize(size_t A) {
+    V.resize(A);
+    N.resize(A);
+    pending.resize(A);
 }
 
-#ifdef ENTROPY
-// Note for ENTROPY implementation:
-// In theory this is wrong as we should update all the entropy terms, one
-// for each different type of particle. In practice we hope this will work
-// anyway, and that there are not going to be huge problems, as each particle
-// should be seen enough times to still keep a decent approximation of its
-// entropy term. Minor errors are ok since this is still an estimation.
-void BeliefNode::updateBeliefAndKnowledge(size_t s) {
-    // Remove entropy term for this state from summatory
-    knowledgeMeasure_ -= trackBelief_[s].negativeEntropy;
-    // Updating belief
-    trackBelief_[s].N += 1;
-    // Computing new entropy term for this state
-    double p = static_cast<double>(trackBelief_[s].N) / static_cast<double>(N+1);
-    double newEntropy = p * std::log(p);
-    // Update values
-    trackBelief_[s].negativeEntropy = newEntropy;
-    knowledgeMeasure_ += newEntropy;
+size_t ActionStats::getCopyBytes() const {
+    return Arena::vectorBytes(V) + Arena::vectorBytes(N) + Arena::vectorBytes(pending);
 }
 
-#else
+template <typename K>
+BeliefNode<K>::BeliefNode(Arena & arena) : N(0), children(arena), stats(arena), V(0.0), actionsV(0.0), bestAction(0), maxMode(false),
+                                           trackBelief_(arena) {}
+
+template <typename K>
+BeliefNode<K>::BeliefNode(const BeliefNode & other, Arena & arena, unsigned minN, NodeCopies<BeliefNode<K>> * copies) : N(other.N), children(arena), stats(other.stats, arena), V(other.V), actionsV(other.actionsV), bestAction(other.bestAction), maxMode(other.maxMode),
+                                                                                   trackBelief_(other.trackBelief_, arena), knowledge_(other.knowledge_) {
+    if ( copies ) ++copies->count;
+    if ( N < minN ) return;
 
-// This is the Max-Belief implementation
-void BeliefNode::updateBeliefAndKnowledge(size_t s) {
-    trackBelief_[s].N += 1;
+    children.reserve(other.children.size());
+    for ( auto & aNode : other.children )
+        children.emplace_back(aNode, arena, minN, copies);
+}
 
-    if ( trackBelief_[s].N > trackBelief_[maxS_].N )
-        maxS_ = s;
+template <typename K>
+void BeliefNode<K>::addActions(size_t A) {
+    if ( children.size() == A ) return;
 
-    knowledgeMeasure_ = static_cast<double>(trackBelief_[maxS_].N) / static_cast<double>(N+1);
+    Arena & arena = children.get_allocator().getArena();
+    children.reserve(A);
+    while ( children.size() < A )
+        children.emplace_back(arena);
+    stats.resize(A);
 }
 
-#endif
+template <typename K>
+size_t BeliefNode<K>::getLeafBytes() const {
+    return Arena::chunkSize(sizeof(BeliefNode)) + stats.getCopyBytes() + trackBelief_.getCopyBytes();
+}
 
-double BeliefNode::getKnowledgeMeasure() const {
-    return knowledgeMeasure_;
+template <typename K>
+size_t BeliefNode<K>::getActionsBytes() const {
+    size_t bytes = Arena::vectorBytes(children);
+    for ( auto & aNode : children )
+        bytes += aNode.children.getCopyBytes();
+    return bytes;
 }
 
-HeadBeliefNode::HeadBeliefNode(size_t A, std::default_random_engine & rand) : BeliefNode(), rand_(&rand) {
-    children.resize(A);
+template <typename K>
+ActionNode<K>::ActionNode(Arena & arena) : children(arena) {}
+
+template <typename K>
+ActionNode<K>::ActionNode(const ActionNode & other, Arena & arena, unsigned minN, NodeCopies<BeliefNode<K>> * copies) : ActionNode(arena) {
+    children.reserve(other.children.size());
+    for ( auto & pair : other.children ) {
+        const size_t key = copies && copies->rekey ? copies->rekey(pair.first) : pair.first;
+        if ( !copies || !copies->shared ) {
+            children[key] = arena.template make<BeliefNode<K>>(*pair.second, arena, minN, copies);
+            continue;
+        }
+        // References to unordered_map values survive the insertions done
+        // while copying the child.
+        auto & copy = copies->nodes[pair.second];
+        if ( !copy ) copy = arena.template make<BeliefNode<K>>(*pair.second, arena, minN, copies);
+        children[key] = copy;
+    }
 }
 
-HeadBeliefNode::HeadBeliefNode(size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, std::default_random_engine & rand) : BeliefNode(), rand_(&rand), beliefSize_(beliefSize) {
-    children.resize(A);
+RootParticles::RootParticles(Arena & arena) : sampleBelief_(arena), alias_(arena), beliefSize_(0) {}
+
+RootParticles::RootParticles(const RootParticles & other, Arena & arena) : sampleBelief_(other.sampleBelief_.begin(), other.sampleBelief_.end(), arena),
+                                                                           alias_(other.alias_.begin(), other.alias_.end(), arena), beliefSize_(other.beliefSize_) {}
+
+void RootParticles::assign(size_t beliefSize, const AIToolbox::POMDP::Belief & b, RandomEngine & rand) {
     std::unordered_map<size_t, unsigned> generatedSamples;
 
     size_t S = b.size();
-    for ( size_t i = 0; i < beliefSize_; ++i )
-        generatedSamples[AIToolbox::sampleProbability(S, b, *rand_)] += 1;
+    for ( size_t i = 0; i < beliefSize; ++i )
+        generatedSamples[AIToolbox::sampleProbability(S, b, rand)] += 1;
 
-    sampleBelief_.reserve(beliefSize_);
-    for ( auto & pair : generatedSamples ) {
+    sampleBelief_.clear();
+    sampleBelief_.reserve(generatedSamples.size());
+    for ( auto & pair : generatedSamples )
         sampleBelief_.emplace_back(pair);
-        // Compute entropy here since we don't have a parent in this case (is it really needed?)
-        // double p = static_cast<double>(pair.second) / static_cast<double>(beliefSize_);
-        // negativeEntropy += p * std::log(p);
+    beliefSize_ = beliefSize;
+    buildAliasTable();
+}
+
+void RootParticles::add(const Particles & particles) {
+    if ( particles.empty() ) return;
+
+    std::unordered_map<size_t, size_t> positions;
+    for ( size_t i = 0; i < sampleBelief_.size(); ++i )
+        positions[sampleBelief_[i].first] = i;
+
+    for ( auto & pair : particles ) {
+        auto it = positions.find(pair.first);
+        if ( it != positions.end() )
+            sampleBelief_[it->second].second += pair.second;
+        else
+            sampleBelief_.emplace_back(pair);
+        beliefSize_ += pair.second;
     }
+    buildAliasTable();
 }
 
-HeadBeliefNode::HeadBeliefNode(size_t A, BeliefNode && bn, std::default_random_engine& rand) : BeliefNode(std::move(bn)), rand_(&rand), beliefSize_(0) {
-    children.resize(A);
-    sampleBelief_.reserve(trackBelief_.size());
-    for ( auto & pair : trackBelief_ ) {
-        sampleBelief_.emplace_back(pair.first, pair.second.N);
-        beliefSize_ += pair.second.N;
+// This is Vose's method, done with integers so that sampling is exact. Each
+// state has weight count * n, and each of the n buckets holds beliefSize_.
+// Buckets of states with less than that are filled with the excess of a
+// state with more.
+void RootParticles::buildAliasTable() {
+    const unsigned n = sampleBelief_.size();
+    const uint64_t bucket = beliefSize_;
+
+    std::vector<uint64_t> weights(n);
+    std::vector<unsigned> small, large;
+    for ( unsigned i = 0; i < n; ++i ) {
+        weights[i] = static_cast<uint64_t>(sampleBelief_[i].second) * n;
+        ( weights[i] < bucket ? small : large ).push_back(i);
+    }
+
+    alias_.assign(n, AliasEntry{static_cast<unsigned>(bucket), 0});
+    while ( !small.empty() && !large.empty() ) {
+        unsigned l = small.back(), g = large.back();
+        small.pop_back();
+
+        alias_[l] = AliasEntry{static_cast<unsigned>(weights[l]), g};
+        weights[g] -= bucket - weights[l];
+        if ( weights[g] < bucket ) {
+            large.pop_back();
+            small.push_back(g);
+        }
     }
-    TrackBelief().swap(trackBelief_); // Clear belief memory
+    // Whatever is left is exactly full.
+    for ( auto i : small ) alias_[i] = AliasEntry{static_cast<unsigned>(bucket), i};
+    for ( auto i : large ) alias_[i] = AliasEntry{static_cast<unsigned>(bucket), i};
 }
 
-bool HeadBeliefNode::isSampleBeliefEmpty() const {
+bool RootParticles::empty() const {
     return sampleBelief_.empty();
 }
 
-size_t HeadBeliefNode::sampleBelief() const {
-    std::uniform_int_distribution<unsigned> generator(1, beliefSize_);
-    int pick = generator(*rand_);
+size_t RootParticles::sample(RandomEngine & rand) const {
+    // A single draw picks both the bucket and the particle within it.
+    const uint64_t bucket = beliefSize_;
+    std::uniform_int_distribution<uint64_t> generator(0, bucket * alias_.size() - 1);
+    uint64_t pick = generator(rand);
 
-    size_t index = 0;
-    while (true) {
-        pick -= sampleBelief_[index].second;
-        if ( pick < 1 ) return sampleBelief_[index].first;
-        ++index;
-    }
+    size_t index = pick / bucket;
+    const auto & entry = alias_[index];
+    return sampleBelief_[ pick % bucket < entry.cut ? index : entry.alias ].first;
 }
 
-size_t HeadBeliefNode::getMostCommonParticle() const {
+size_t RootParticles::getMostCommon() const {
     // We return the most common particle in the head belief
-    size_t bestGuess; unsigned bestGuessCount = 0;
+    size_t bestGuess = 0; unsigned bestGuessCount = 0;
     for ( auto & pair : sampleBelief_ ) {
         if ( pair.second > bestGuessCount ) {
             bestGuessCount = pair.second;
@@ -105,18 +174,94 @@ size_t HeadBeliefNode::getMostCommonParticle() const {
     return bestGuess;
 }
 
-void HeadBeliefNode::printSampleBelief() const {
+void RootParticles::print() const {
     std::cout << "State\t | Count\n";
     std::cout << "-----------------------------------\n";
     for ( auto & pair : sampleBelief_ ) {
         std::cout << pair.first << "\t | " << pair.second << "\n";
     }
-            std::cout << "-----------------------------------\n";
+    std::cout << "-----------------------------------\n";
+}
+
+template <typename K>
+HeadBeliefNode<K>::HeadBeliefNode(size_t A, Arena & arena, RandomEngine & rand) : BeliefNode<K>(arena), visits(0), rand_(&rand), particles_(arena) {
+    this->addActions(A);
 }
 
-void BeliefNode::printTrackBelief() const {
+template <typename K>
+HeadBeliefNode<K>::HeadBeliefNode(size_t A, size_t beliefSize, const AIToolbox::POMDP::Belief & b, Arena & arena, RandomEngine & rand) :
+                                                                                            BeliefNode<K>(arena), visits(0), rand_(&rand), particles_(arena) {
+    this->addActions(A);
+    particles_.assign(beliefSize, b, rand);
+}
+
+template <typename K>
+HeadBeliefNode<K>::HeadBeliefNode(size_t A, const BeliefNode<K> & bn, Arena & arena, RandomEngine& rand, NodeCopies<BeliefNode<K>> * copies) : BeliefNode<K>(bn, arena, 0, copies), visits(0), rand_(&rand), particles_(arena) {
+    this->addActions(A);
+    particles_.assign(this->trackBelief_);
+    this->trackBelief_.clear(); // Clear belief memory
+}
+
+template <typename K>
+HeadBeliefNode<K>::HeadBeliefNode(size_t A, const HeadBeliefNode & particles, Arena & arena, RandomEngine& rand) : BeliefNode<K>(arena), visits(0), rand_(&rand),
+                                                                                                                particles_(particles.particles_, arena) {
+    this->addActions(A);
+}
+
+template <typename K>
+HeadBeliefNode<K>::HeadBeliefNode(const HeadBeliefNode & other, Arena & arena, unsigned minN, NodeCopies<BeliefNode<K>> * copies) : BeliefNode<K>(other, arena, minN, copies), visits(other.visits), rand_(other.rand_),
+                                                                                               particles_(other.particles_, arena) {}
+
+template <typename K>
+void HeadBeliefNode<K>::addParticles(const Particles & particles) {
+    particles_.add(particles);
+}
+
+template <typename K>
+unsigned HeadBeliefNode<K>::refill(size_t beliefSize, const AIToolbox::POMDP::Belief & b, RandomEngine & rand) {
+    if ( !particles_.empty() ) return 0;
+
+    particles_.assign(beliefSize, b, rand);
+    return 1;
+}
+
+template <typename K>
+bool HeadBeliefNode<K>::isSampleBeliefEmpty() const {
+    return particles_.empty();
+}
+
+template <typename K>
+size_t HeadBeliefNode<K>::sampleBelief() const {
+    return particles_.sample(*rand_);
+}
+
+template <typename K>
+size_t HeadBeliefNode<K>::sampleBelief(RandomEngine & rand) const {
+    return particles_.sample(rand);
+}
+
+template <typename K>
+size_t HeadBeliefNode<K>::getMostCommonParticle() const {
+    return particles_.getMostCommon();
+}
+
+template <typename K>
+void HeadBeliefNode<K>::printSampleBelief() const {
+    particles_.print();
+}
+
+template <typename K>
+void BeliefNode<K>::printTrackBelief() const {
     std::cout << "Track Belief:\n";
     for ( auto & pair : trackBelief_ ) {
         std::cout << "State: " << pair.first << ", Count: " << pair.second.N << "\n";
     }
 }
+
+template class BeliefNode<Entropy>;
+template struct ActionNode<Entropy>;
+template class HeadBeliefNode<Entropy>;
+
+template class BeliefNode<MaxBelief>;
+template struct ActionNode<MaxBelief>;
+template class HeadBeliefNode<MaxBelief>;
@@ -0,0 +1,89 @@
+#include <AIToolbox/Impl/UCB.hpp>
+#include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+// This is how action statistics used to be stored: one struct per action,
+// together with the children of the action.
+struct OldActionNode {
+    std::unordered_map<size_t, BeliefNode<Entropy> *> children;
+    double V = 0.0;
+    unsigned N = 0;
+};
+
+size_t oldFindBestBonusA(const std::vector<OldActionNode> & actions, double logCount, double exploration) {
+    auto evaluationFunction = [exploration, logCount](const OldActionNode & an){
+        return an.V + exploration * std::sqrt( logCount / an.N );
+    };
+
+    size_t best = 0;
+    double bestValue = evaluationFunction(actions[0]);
+    for ( size_t a = 1; a < actions.size(); ++a ) {
+        double actionValue = evaluationFunction(actions[a]);
+        if ( actionValue > bestValue ) {
+            bestValue = actionValue;
+            best = a;
+        }
+    }
+    return best;
+}
+
+// This measures the cost of selecting an action with UCB1, with the old
+// array of structs and with the new separate arrays. Compile with -mavx2
+// (USE_AVX2 in CMake) to use the vectorized version.
+int main(int argc, char * argv[]) {
+    unsigned calls = argc > 1 ? std::stoi(argv[1]) : 20000000;
+    double exploration = 5.0;
+
+#ifdef __AVX2__
+    std::cout << "Using AVX2\n";
+#else
+    std::cout << "Using scalar code\n";
+#endif
+    std::cout << "Actions\t    Old ns\t    New ns\tSpeedup\n";
+
+    RandomEngine rand(0);
+    std::uniform_real_distribution<double> valueDist(0.0, 1.0);
+    std::uniform_int_distribution<unsigned> countDist(1, 1000);
+
+    for ( size_t A = 4; A <= 1024; A *= 2 ) {
+        std::vector<OldActionNode> oldActions(A);
+        Arena arena;
+        ActionStats stats(arena);
+        stats.resize(A);
+
+        for ( size_t a = 0; a < A; ++a ) {
+            oldActions[a].V = stats.V[a] = valueDist(rand);
+            oldActions[a].N = stats.N[a] = countDist(rand);
+        }
+
+        // We vary the count so every call does different work.
+        unsigned reps = std::max<unsigned>(calls / A, 1);
+        size_t oldSum = 0, newSum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for ( unsigned i = 0; i < reps; ++i )
+            oldSum += oldFindBestBonusA(oldActions, std::log(i + 2.0), exploration);
+        std::chrono::duration<double, std::nano> oldTime = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for ( unsigned i = 0; i < reps; ++i )
+            newSum += AIToolbox::Impl::findBestBonusA(stats.V.data(), stats.N.data(), A, std::log(i + 2.0), exploration);
+        std::chrono::duration<double, std::nano> newTime = std::chrono::steady_clock::now() - start;
+
+        if ( oldSum != newSum ) {
+            std::cout << "Selected actions differ for A = " << A << "!\n";
+            return 1;
+        }
+
+        double oldNs = oldTime.count() / reps, newNs = newTime.count() / reps;
+        std::cout << std::setw(7) << A << '\t' << std::setw(10) << oldNs << '\t' << std::setw(10) << newNs << '\t' << oldNs / newNs << '\n';
+    }
+
+    return 0;
+}
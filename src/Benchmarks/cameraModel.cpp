@@ -0,0 +1,59 @@
+#include <MasterThesis/CameraBasic/cameraBasicProblem.hpp>
+#include <MasterThesis/CameraPath/cameraPathProblem.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+// This measures the cost of the calls planners make on the camera models:
+// sampling a step, and computing an observation probability as done by
+// exact belief updates. States and actions are drawn at random beforehand,
+// so that only the model is timed.
+template <typename M>
+void measure(const char * name, unsigned calls, double & sink) {
+    std::cout << name << '\n';
+    std::cout << "Grid\tBuild ms\tSOR ns\tObsP ns\n";
+
+    for ( unsigned gridSize : { 10u, 20u, 50u, 100u, 200u } ) {
+        auto start = std::chrono::steady_clock::now();
+        M model(gridSize, 0.9);
+        std::chrono::duration<double, std::milli> build = std::chrono::steady_clock::now() - start;
+
+        RandomEngine rand(0);
+        std::uniform_int_distribution<size_t> distS(0, model.getS() - 1), distA(0, model.getA() - 1), distO(0, model.getO() - 1);
+
+        std::vector<size_t> states(calls), actions(calls), observations(calls);
+        for ( unsigned i = 0; i < calls; ++i ) {
+            states[i] = distS(rand);
+            actions[i] = distA(rand);
+            observations[i] = distO(rand);
+        }
+
+        start = std::chrono::steady_clock::now();
+        for ( unsigned i = 0; i < calls; ++i )
+            sink += std::get<1>(model.sampleSOR(states[i], actions[i], rand));
+        std::chrono::duration<double, std::nano> sor = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for ( unsigned i = 0; i < calls; ++i )
+            sink += model.getObservationProbability(states[i], actions[i], observations[i]);
+        std::chrono::duration<double, std::nano> obs = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(4) << gridSize << '\t' << std::setw(8) << std::fixed << std::setprecision(2) << build.count() << '\t'
+                  << std::setw(6) << std::setprecision(1) << sor.count() / calls << '\t'
+                  << std::setw(7) << obs.count() / calls << '\n';
+    }
+}
+
+int main(int argc, char * argv[]) {
+    unsigned calls = argc > 1 ? std::stoi(argv[1]) : 5000000;
+
+    double sink = 0.0;
+    measure<CameraBasicModel>("CameraBasicModel", calls, sink);
+    measure<CameraPathModel>("CameraPathModel", calls, sink);
+    // Prevents the compiler from optimizing everything away.
+    if ( sink == 42.0 ) std::cout << sink << '\n';
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <MasterThesis/Algorithms/rPOMCP.hpp>
+#include <MasterThesis/Algorithms/Utils/ThreadPool.hpp>
+#include <MasterThesis/CameraPath/cameraPathProblem.hpp>
+#include <MasterThesis/makeMultiExperimentPOMCP.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+// This benchmark measures the latency of a step of the multi target
+// experiment, where each target has its own rPOMCP solver, as the number of
+// targets and of threads planning for them increases.
+int main(int argc, char * argv[]) {
+    unsigned gridSize   = argc > 1 ? std::stoi(argv[1]) : 20;
+    unsigned horizon    = argc > 2 ? std::stoi(argv[2]) : 5;
+    unsigned iterations = argc > 3 ? std::stod(argv[3]) : 10000;
+    unsigned maxThreads = argc > 4 ? std::stoi(argv[4]) : 16;
+    unsigned steps      = 5;
+
+    CameraPathModel model(gridSize, 0.9);
+    size_t S = model.getS();
+    AIToolbox::POMDP::Belief belief(S, 1.0 / S);
+    RandomEngine rand(RandomStreams::getSeed());
+
+    std::cout << "Grid " << gridSize << ", horizon " << horizon << ", " << iterations << " iterations per step\n";
+    std::cout << "People\tThreads\tms/step\tSpeedup\n";
+
+    for ( unsigned nrPpl : { 1u, 2u, 5u, 10u, 20u } ) {
+        double base = 0.0;
+        for ( unsigned threads = 1; threads <= maxThreads; threads *= 2 ) {
+            std::vector<rPOMCP<CameraPathModel>> solvers;
+            solvers.reserve(nrPpl);
+            for ( unsigned p = 0; p < nrPpl; ++p )
+                solvers.emplace_back(model, 1000, iterations, 5);
+
+            std::vector<size_t> pos(nrPpl), obs(nrPpl);
+            for ( auto & s : pos )
+                s = AIToolbox::sampleProbability(S, belief, rand);
+
+            ThreadPool pool(threads);
+
+            auto start = std::chrono::steady_clock::now();
+            pool.parallelFor(nrPpl, [&](unsigned p) { solvers[p].sampleAction(belief, horizon); });
+            size_t a = extractAction(solvers);
+            for ( unsigned i = 1; i < steps; ++i ) {
+                for ( unsigned p = 0; p < nrPpl; ++p )
+                    std::tie(pos[p], obs[p], std::ignore) = model.sampleSOR(pos[p], a);
+                pool.parallelFor(nrPpl, [&](unsigned p) { solvers[p].sampleAction(a, obs[p], horizon); });
+                a = extractAction(solvers);
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            double msPerStep = elapsed.count() / steps;
+            if ( threads == 1 ) base = msPerStep;
+
+            std::cout << std::setw(6) << nrPpl << '\t' << std::setw(7) << threads << '\t'
+                      << std::setw(7) << std::fixed << std::setprecision(1) << msPerStep << '\t'
+                      << std::setprecision(2) << base / msPerStep << std::endl;
+
+            if ( threads >= nrPpl ) break;
+        }
+    }
+
+    return 0;
+}
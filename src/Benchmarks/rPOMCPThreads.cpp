@@ -0,0 +1,44 @@
+#include <MasterThesis/Algorithms/rPOMCP.hpp>
+#include <MasterThesis/CameraPath/cameraPathProblem.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+// This benchmark measures how many rPOMCP simulations per second we can do
+// using root and tree parallelization, as the number of threads increases.
+int main(int argc, char * argv[]) {
+    unsigned gridSize   = argc > 1 ? std::stoi(argv[1]) : 20;
+    unsigned horizon    = argc > 2 ? std::stoi(argv[2]) : 5;
+    unsigned iterations = argc > 3 ? std::stod(argv[3]) : 100000;
+    unsigned maxThreads = argc > 4 ? std::stoi(argv[4]) : 16;
+    unsigned steps      = 5;
+
+    CameraPathModel model(gridSize, 0.9);
+    size_t S = model.getS();
+    AIToolbox::POMDP::Belief belief(S, 1.0 / S);
+
+    std::cout << "Grid " << gridSize << ", horizon " << horizon << ", " << iterations << " iterations per step\n";
+    std::cout << "Mode\tThreads\t  Sims/sec\tSpeedup\n";
+
+    for ( auto mode : { Parallelism::Root, Parallelism::Tree } ) {
+        double base = 0.0;
+        for ( unsigned threads = 1; threads <= maxThreads; threads *= 2 ) {
+            rPOMCP<CameraPathModel> solver(model, 1000, iterations, 5, 500, threads, mode);
+
+            auto start = std::chrono::steady_clock::now();
+            for ( unsigned i = 0; i < steps; ++i )
+                solver.sampleAction(belief, horizon);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            double simsPerSec = steps * iterations / elapsed.count();
+            if ( threads == 1 ) base = simsPerSec;
+
+            std::cout << ( mode == Parallelism::Root ? "Root" : "Tree" ) << '\t'
+                      << std::setw(7) << threads << '\t' << std::setw(10) << static_cast<unsigned>(simsPerSec) << '\t' << simsPerSec / base << std::endl;
+        }
+    }
+
+    return 0;
+}
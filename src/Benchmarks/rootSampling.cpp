@@ -0,0 +1,67 @@
+#include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+// This is how the head node used to sample its particles, scanning the
+// state-count pairs linearly. It is kept here as a reference point.
+size_t linearSample(const std::vector<std::pair<size_t, unsigned>> & particles, unsigned beliefSize, RandomEngine & rand) {
+    std::uniform_int_distribution<unsigned> generator(1, beliefSize);
+    int pick = generator(rand);
+
+    size_t index = 0;
+    while (true) {
+        pick -= particles[index].second;
+        if ( pick < 1 ) return particles[index].first;
+        ++index;
+    }
+}
+
+// This measures the cost of sampling a particle from the root of the tree,
+// as the number of distinct states in it increases.
+int main(int argc, char * argv[]) {
+    unsigned samples    = argc > 1 ? std::stoi(argv[1]) : 10000000;
+    unsigned beliefSize = argc > 2 ? std::stoi(argv[2]) : 10000;
+
+    std::cout << beliefSize << " particles\n";
+    std::cout << "Distinct\tLinear ns\t Alias ns\n";
+
+    size_t sink = 0;
+    for ( unsigned distinct : { 1u, 10u, 100u, 1000u, 10000u } ) {
+        RandomEngine rand(0);
+        Arena arena;
+
+        // Particles are spread uniformly, which is the worst case for the
+        // linear scan among beliefs with the same number of states.
+        AIToolbox::POMDP::Belief b(distinct, 1.0 / distinct);
+        auto & head = *arena.make<HeadBeliefNode<Entropy>>(1, beliefSize, b, arena, rand);
+
+        std::vector<std::pair<size_t, unsigned>> particles;
+        std::unordered_map<size_t, unsigned> counts;
+        for ( unsigned i = 0; i < beliefSize; ++i )
+            counts[head.sampleBelief(rand)] += 1;
+        unsigned total = 0;
+        for ( auto & pair : counts ) {
+            particles.emplace_back(pair);
+            total += pair.second;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for ( unsigned i = 0; i < samples; ++i )
+            sink += linearSample(particles, total, rand);
+        std::chrono::duration<double, std::nano> linear = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for ( unsigned i = 0; i < samples; ++i )
+            sink += head.sampleBelief(rand);
+        std::chrono::duration<double, std::nano> alias = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(8) << counts.size() << '\t' << std::setw(9) << linear.count() / samples << '\t' << std::setw(9) << alias.count() / samples << '\n';
+    }
+    // Prevents the compiler from optimizing everything away.
+    if ( sink == 42 ) std::cout << sink << '\n';
+
+    return 0;
+}
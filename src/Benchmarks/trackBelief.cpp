@@ -0,0 +1,79 @@
+#include <MasterThesis/Algorithms/Utils/TreeNodes.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+
+// This is the belief node update as it was done with std::unordered_map,
+// kept here as a reference point.
+template <typename K>
+struct MapBeliefNode {
+    void updateBeliefAndKnowledge(size_t s) {
+        K::update(knowledge, trackBelief[s], N);
+    }
+
+    double getKnowledgeMeasure() const { return K::value(knowledge); }
+
+    std::unordered_map<size_t, typename K::Particle> trackBelief;
+    unsigned N = 0;
+    typename K::Knowledge knowledge;
+};
+
+// This measures the cost of a single belief update, for nodes which see a
+// given number of distinct states. Each node receives the same number of
+// updates, as nodes in the tree do, so insertions are part of the cost.
+template <typename Node, typename Make>
+double timeUpdates(Make make, unsigned nodes, unsigned updates, unsigned distinct, double & sink) {
+    RandomEngine rand(0);
+    std::uniform_int_distribution<size_t> dist(0, distinct - 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for ( unsigned n = 0; n < nodes; ++n ) {
+        Node & node = make();
+        for ( unsigned i = 0; i < updates; ++i ) {
+            // Spread states out as they would be in a grid.
+            node.updateBeliefAndKnowledge(dist(rand) * 37);
+            node.N += 1;
+        }
+        sink += node.getKnowledgeMeasure();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / ( static_cast<double>(nodes) * updates );
+}
+
+template <typename K>
+void compare(unsigned nodes, unsigned updates, double & sink) {
+    std::cout << K::name() << '\n';
+    std::cout << "Distinct\t   Map ns\t  Flat ns\n";
+
+    for ( unsigned distinct : { 1u, 4u, 8u, 16u, 64u, 256u, 1024u } ) {
+        Arena arena;
+        MapBeliefNode<K> mapNode;
+        auto makeMap = [&]() -> MapBeliefNode<K> & { mapNode = MapBeliefNode<K>(); return mapNode; };
+        auto makeFlat = [&]() -> BeliefNode<K> & { arena.release(); return *arena.make<BeliefNode<K>>(arena); };
+
+        double mapNs  = timeUpdates<MapBeliefNode<K>>(makeMap, nodes, updates, distinct, sink);
+        double flatNs = timeUpdates<BeliefNode<K>>(makeFlat, nodes, updates, distinct, sink);
+
+        std::cout << std::setw(8) << distinct << '\t' << std::setw(9) << mapNs << '\t' << std::setw(9) << flatNs << '\n';
+    }
+}
+
+int main(int argc, char * argv[]) {
+    unsigned updates = argc > 1 ? std::stoi(argv[1]) : 1000;
+    unsigned total   = argc > 2 ? std::stoi(argv[2]) : 10000000;
+    unsigned nodes   = std::max(total / updates, 1u);
+
+    std::cout << updates << " updates per node\n";
+
+    double sink = 0.0;
+    compare<Entropy>(nodes, updates, sink);
+    compare<MaxBelief>(nodes, updates, sink);
+    // Prevents the compiler from optimizing everything away.
+    if ( sink == 42.0 ) std::cout << sink << '\n';
+
+    return 0;
+}
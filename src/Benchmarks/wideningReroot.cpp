@@ -0,0 +1,101 @@
+#include <AIToolbox/POMDP/Algorithms/POMCP.hpp>
+#include <MasterThesis/Algorithms/rPOMCP.hpp>
+#include <MasterThesis/CameraPath/cameraPathProblem.hpp>
+
+#include <iostream>
+#include <string>
+
+using Solver = AIToolbox::POMDP::POMCP<CameraPathModel>;
+using RSolver = rPOMCP<CameraPathModel>;
+
+size_t countNodes(const Solver::BeliefNode & b) {
+    size_t count = 1;
+    for ( auto & aNode : b.children )
+        for ( auto & pair : aNode.children )
+            count += countNodes(pair.second);
+    return count;
+}
+
+size_t countNodes(const RSolver::BeliefNode * b) {
+    size_t count = 1;
+    for ( auto & aNode : b->children )
+        for ( auto & pair : aNode.children )
+            count += countNodes(pair.second);
+    return count;
+}
+
+// We take the observation next to the largest child which has none, so that
+// it is merged into a subtree with something to keep. This returns O if all
+// observations next to it have a child.
+template <typename Map>
+size_t mergedObservation(const Map & children, size_t O) {
+    auto has = [&children](size_t o) {
+        for ( auto & pair : children )
+            if ( pair.first == o ) return true;
+        return false;
+    };
+
+    auto largest = children.begin();
+    for ( auto it = children.begin(); it != children.end(); ++it )
+        if ( countNodes(it->second) > countNodes(largest->second) )
+            largest = it;
+
+    for ( size_t d = 1; d < O; ++d ) {
+        if ( largest->first + d < O && !has(largest->first + d) ) return largest->first + d;
+        if ( largest->first >= d && !has(largest->first - d) ) return largest->first - d;
+    }
+    return O;
+}
+
+// This reroots a solver at a merged observation, and returns whether it kept
+// the subtree of the closest child; it counts skipped trials as kept.
+template <typename S>
+bool keepsSubtree(S & solver, const AIToolbox::POMDP::Belief & belief, size_t O, unsigned horizon) {
+    solver.setProgressiveWidening(1.0, 0.5);
+    size_t a = solver.sampleAction(belief, horizon);
+
+    auto & children = solver.getGraph().children[a].children;
+    size_t o = mergedObservation(children, O);
+    if ( o == O ) return true;
+
+    size_t expected = countNodes(AIToolbox::Impl::closestObservation(children, o)->second) - 1;
+    solver.sampleAction(a, o, horizon);
+
+    return solver.getStats().nodesReused == expected;
+}
+
+// This checks that with progressive widening POMCP and rPOMCP keep their
+// tree when the real observation was merged into the child of a close one,
+// rather than restarting from a uniform belief. It returns non-zero if any
+// step lost the subtree.
+int main(int argc, char * argv[]) {
+    unsigned gridSize   = argc > 1 ? std::stoi(argv[1]) : 20;
+    unsigned horizon    = argc > 2 ? std::stoi(argv[2]) : 5;
+    unsigned iterations = argc > 3 ? std::stod(argv[3]) : 2000;
+    unsigned trials     = argc > 4 ? std::stoi(argv[4]) : 10;
+
+    CameraPathModel model(gridSize, 0.9);
+    size_t S = model.getS(), O = model.getO();
+    AIToolbox::POMDP::Belief belief(S, 1.0 / S);
+
+    unsigned lost = 0;
+    for ( int solver = 0; solver < 2; ++solver ) {
+        unsigned kept = 0;
+        for ( unsigned t = 0; t < trials; ++t ) {
+            bool ok;
+            if ( solver == 0 ) {
+                Solver pomcp(model, 1000, iterations, 5);
+                ok = keepsSubtree(pomcp, belief, O, horizon);
+            }
+            else {
+                RSolver rpomcp(model, 1000, iterations, 5);
+                ok = keepsSubtree(rpomcp, belief, O, horizon);
+            }
+            if ( ok ) ++kept;
+            else ++lost;
+        }
+        std::cout << ( solver ? "rPOMCP" : "POMCP" ) << " merged observations: " << kept << " subtrees kept, " << trials - kept << " lost\n";
+    }
+
+    return lost ? 1 : 0;
+}
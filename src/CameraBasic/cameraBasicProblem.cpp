@@ -1,12 +1,11 @@
 #include <MasterThesis/CameraBasic/cameraBasicProblem.hpp>
 
 #include <cassert>
-#include <AIToolbox/Impl/Seeder.hpp>
 
 constexpr int cameraField = 10;
 
 CameraBasicModel::CameraBasicModel(unsigned gridSize, double d) : gridSize_(gridSize), gridCells_(gridSize_*gridSize_), S(gridCells_+1),
-                                                                  discount_(d), rand_(AIToolbox::Impl::Seeder::getSeed())
+                                                                  discount_(d), rand_(RandomStreams::getSeed()), goal_{0, 0}
 {
     if ( gridSize < 1 ) throw std::invalid_argument("This grid size is not allowed: " + std::to_string(gridSize));
     bool even = !(gridSize_ % 2);
@@ -35,6 +34,26 @@ CameraBasicModel::CameraBasicModel(unsigned gridSize, double d) : gridSize_(grid
             ++a;
         }
     }
+
+    // Initialize lookup tables. Cameras tile the grid, so each cell is seen
+    // by exactly one of them.
+    neighbours_.resize(S);
+    cellCameras_.resize(S);
+    for ( size_t s = 0; s < S; ++s ) {
+        for ( unsigned dir = 0; dir < 4; ++dir )
+            neighbours_[s][dir] = computeNextDirState(s, dir);
+        // The outside is not seen by any camera.
+        if ( s == S-1 ) {
+            cellCameras_[s] = {{ static_cast<unsigned>(A), 0 }};
+            continue;
+        }
+        unsigned x = s % gridSize_, y = s / gridSize_;
+        unsigned camera = (x / cameraField) + (y / cameraField) * cameraSize_;
+        cellCameras_[s] = {{
+            camera,
+            (x - cameraData[camera][1]) + (y - cameraData[camera][2]) * cameraData[camera][3] + 1
+        }};
+    }
 }
 
 // INFO FUNCTIONS
@@ -51,52 +70,69 @@ double CameraBasicModel::getDiscount() const { return discount_; }
 // SAMPLING FUNCTIONS
 
 std::tuple<size_t, size_t, double> CameraBasicModel::sampleSOR(size_t s, size_t a) const {
+    return sampleSOR(s, a, rand_);
+}
+
+std::tuple<size_t, size_t, double> CameraBasicModel::sampleSOR(size_t s, size_t a, RandomEngine & rand) const {
     //a *= 2;
     //if ( !(A % 2) && ( a / cameraSize_ ) % 2 ) ++a;
 
-    size_t s1 = sampleTransition(s);
-    size_t o = sampleObservation(s1, a);
+    size_t s1 = sampleTransition(s, rand);
+    size_t o = sampleObservation(s1, a, rand);
 
     return std::make_tuple(s1, o, 0.0);
 }
 
-std::tuple<size_t, double> CameraBasicModel::sampleOR(size_t, size_t a, size_t s1) const {
+std::tuple<size_t, double> CameraBasicModel::sampleOR(size_t s, size_t a, size_t s1) const {
+    return sampleOR(s, a, s1, rand_);
+}
+
+std::tuple<size_t, double> CameraBasicModel::sampleOR(size_t, size_t a, size_t s1, RandomEngine & rand) const {
 //    a *= 2;
 //    if ( !(A % 2) && ( a / cameraSize_ ) % 2 ) ++a;
 
-    return std::make_tuple(sampleObservation(s1, a), 0.0);
+    return std::make_tuple(sampleObservation(s1, a, rand), 0.0);
 }
 
-std::tuple<size_t, double> CameraBasicModel::sampleSR(size_t s, size_t) const {
-    return std::make_tuple(sampleTrajectoryTransition(s), 0.0);
+std::tuple<size_t, double> CameraBasicModel::sampleSR(size_t s, size_t a) const {
+    return sampleSR(s, a, goal_, rand_);
+}
+
+CameraBasicModel::Goal CameraBasicModel::sampleGoal(RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> distg(0, gridSize_-1);
+    Goal goal;
+    goal.x = distg(rand); goal.y = distg(rand);
+    return goal;
+}
+
+std::tuple<size_t, double> CameraBasicModel::sampleSR(size_t s, size_t, Goal & goal, RandomEngine & rand) const {
+    return std::make_tuple(sampleTrajectoryTransition(s, goal, rand), 0.0);
 }
 
 // IMPLEMENTATIONS
 
-size_t CameraBasicModel::sampleTransition(size_t s) const {
-    static std::uniform_int_distribution<unsigned> dist1(1, 20);
-    static std::uniform_int_distribution<unsigned> dist2(0, 3);
+size_t CameraBasicModel::sampleTransition(size_t s, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(1, 20);
+    std::uniform_int_distribution<unsigned> dist2(0, 3);
 
     // From outside
     if ( s == S-1 ) {
         // 0.05 chance for both
-        auto dice = dist1(rand_);
+        auto dice = dist1(rand);
         if ( dice == 19 ) return entranceA_;
         if ( dice == 20 ) return entranceB_;
         return s;
     }
 
-    return getNextDirState(s, dist2(rand_));
+    return getNextDirState(s, dist2(rand));
 }
 
-size_t CameraBasicModel::sampleTrajectoryTransition(size_t s) const {
-    static std::uniform_int_distribution<unsigned> dist1(0, 9);
-    static std::uniform_int_distribution<unsigned> distg(0, gridSize_-1);
-    static size_t xg = 0, yg = 0;
+size_t CameraBasicModel::sampleTrajectoryTransition(size_t s, Goal & goal, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(0, 9);
 
-    if ( s == coordToState(xg, yg) || dist1(rand_) == 0 ) {
-        xg = distg(rand_); yg = distg(rand_);
-    }
+    if ( s == coordToState(goal.x, goal.y) || dist1(rand) == 0 )
+        goal = sampleGoal(rand);
+    const size_t xg = goal.x, yg = goal.y;
 
     size_t x, y;
     std::tie(x, y) = stateToCoord(s);
@@ -110,14 +146,14 @@ size_t CameraBasicModel::sampleTrajectoryTransition(size_t s) const {
     return getNextDirState(s, dir);
 }
 
-double computePrecision(int puc, int data) {
+static double computePrecision(int puc, int data) {
     // 0.5-1
     return 1.0 - ( std::abs(puc - data/2 - 1) / (double) data );
 }
 
-size_t CameraBasicModel::sampleObservation(size_t s1, size_t a) const {
-    static std::uniform_int_distribution<unsigned> dist1(0, 4);
-    static std::uniform_real_distribution<double>  prob(0, 1);
+size_t CameraBasicModel::sampleObservation(size_t s1, size_t a, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(0, 4);
+    std::uniform_real_distribution<double>  prob(0, 1);
 
     size_t positionUnderCamera = checkCameraField(a, s1);
 
@@ -129,9 +165,9 @@ size_t CameraBasicModel::sampleObservation(size_t s1, size_t a) const {
         double precision = computePrecision(positionUnderCamera, cameraData[a][0]);
 
         // Camera worked correctly
-        if ( precision > prob(rand_) ) return positionUnderCamera;
+        if ( precision > prob(rand) ) return positionUnderCamera;
         // We return a state close to the one we saw (kind of noise..) or nothing
-        int cameraCheck = dist1(rand_);
+        int cameraCheck = dist1(rand);
         if ( cameraCheck == 4 ) return positionUnderCamera;
         return checkCameraField( a, getNextDirState(s1, cameraCheck) );
     }
@@ -177,9 +213,62 @@ double CameraBasicModel::getTransitionProbability(size_t s, size_t, size_t s1) c
     return retvalue;
 }
 
+// SPARSE PROBABILITIES
+
+// This adds p to the probability of x in the list, adding x if it is not
+// there yet.
+static void addOutcome(std::vector<std::pair<size_t, double>> & out, size_t x, double p) {
+    for ( auto & outcome : out ) {
+        if ( outcome.first == x ) {
+            outcome.second += p;
+            return;
+        }
+    }
+    out.emplace_back(x, p);
+}
+
+void CameraBasicModel::getSuccessors(size_t s, size_t, std::vector<std::pair<size_t, double>> & out) const {
+    out.clear();
+    if ( s == S-1 ) {
+        out.emplace_back(s, 0.9);
+        out.emplace_back(entranceA_, 0.05);
+        // With an odd grid both entrances are the same cell.
+        if ( entranceB_ != entranceA_ ) out.emplace_back(entranceB_, 0.05);
+        return;
+    }
+    // Moves which bump into walls add up on the same cell.
+    for ( unsigned i = 0; i < 4; ++i )
+        addOutcome(out, getNextDirState(s, i), 0.25);
+}
+
+void CameraBasicModel::getObservations(size_t s1, size_t a, std::vector<std::pair<size_t, double>> & out) const {
+    out.clear();
+    size_t positionUnderCamera = checkCameraField(a, s1);
+
+    if ( !positionUnderCamera ) {
+        out.emplace_back(0, 1.0);
+        return;
+    }
+    double precision = computePrecision(positionUnderCamera, cameraData[a][0]);
+    double error = (1.0 - precision)/5.0;
+
+    // As in getObservationProbability, the correct observation does not
+    // accumulate the error of neighbours which map back to it.
+    out.emplace_back(positionUnderCamera, precision + error);
+    for ( unsigned i = 0; i < 4; ++i ) {
+        size_t o = checkCameraField(a, getNextDirState(s1, i));
+        if ( o != positionUnderCamera ) addOutcome(out, o, error);
+    }
+}
+
 // MOVEMENT AND CAMERA CODE
 
 size_t CameraBasicModel::getNextDirState(size_t s, unsigned dir) const {
+    assert(s < S && dir < 4);
+    return neighbours_[s][dir];
+}
+
+size_t CameraBasicModel::computeNextDirState(size_t s, unsigned dir) const {
     size_t s1;
     switch ( dir ) {
         case 0:
@@ -203,22 +292,9 @@ size_t CameraBasicModel::getNextDirState(size_t s, unsigned dir) const {
 
 size_t CameraBasicModel::checkCameraField(size_t a, size_t s) const {
     assert(a < A);
-    if ( s == S - 1 ) return 0;
-
-    int x, y;
-    std::tie(x,y) = stateToCoord(s);
-
-    int positionUnderCameraX, positionUnderCameraY;
-    positionUnderCameraX = x - static_cast<int>(cameraData[a][1]);
-    positionUnderCameraY = y - static_cast<int>(cameraData[a][2]);
-
-    size_t positionUnderCamera;
-    if ( positionUnderCameraX < 0 || positionUnderCameraY < 0 || positionUnderCameraX >= cameraField || positionUnderCameraY >= cameraField )
-        positionUnderCamera = 0;
-    else
-        positionUnderCamera = positionUnderCameraX + positionUnderCameraY * cameraData[a][3] + 1;
-
-    return positionUnderCamera;
+    // The outside has no camera, so it is never seen.
+    const auto & camera = cellCameras_[s];
+    return camera[0] == a ? camera[1] : 0;
 }
 
 bool CameraBasicModel::isTerminal(size_t) const { return false; }
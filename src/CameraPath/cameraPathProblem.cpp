@@ -1,7 +1,6 @@
 #include <MasterThesis/CameraPath/cameraPathProblem.hpp>
 
 #include <cassert>
-#include <AIToolbox/Impl/Seeder.hpp>
 
 constexpr int cameraField = 10;
 constexpr int preferredPathProbabilityD20 = 14;
@@ -9,7 +8,7 @@ constexpr double preferredPathProbability = 0.7;
 constexpr double nonPreferredPathProbability = 0.1;
 
 CameraPathModel::CameraPathModel(unsigned gridSize, double d) : gridSize_(gridSize), gridCells_(gridSize_*gridSize_), S(gridCells_*4+1),
-                                                                  discount_(d), rand_(AIToolbox::Impl::Seeder::getSeed())
+                                                                  discount_(d), rand_(RandomStreams::getSeed()), goal_{0, 0}
 {
     if ( gridSize < 1 ) throw std::invalid_argument("This grid size is not allowed: " + std::to_string(gridSize));
     bool even = !(gridSize_ % 2);
@@ -38,6 +37,22 @@ CameraPathModel::CameraPathModel(unsigned gridSize, double d) : gridSize_(gridSi
             ++a;
         }
     }
+
+    // Initialize lookup tables. Cameras tile the grid, so each cell is seen
+    // by exactly one of them.
+    neighbours_.resize(gridCells_);
+    cellCameras_.resize(gridCells_);
+    for ( size_t s = 0; s < gridCells_; ++s ) {
+        for ( unsigned dir = 0; dir < 4; ++dir )
+            neighbours_[s][dir] = computeNextDirState(s, dir);
+
+        unsigned x = s % gridSize_, y = s / gridSize_;
+        unsigned camera = (x / cameraField) + (y / cameraField) * cameraSize_;
+        cellCameras_[s] = {{
+            camera,
+            (x - cameraData[camera][1]) + (y - cameraData[camera][2]) * cameraData[camera][3] + 1
+        }};
+    }
 }
 
 // INFO FUNCTIONS
@@ -57,41 +72,71 @@ double CameraPathModel::getDiscount() const { return discount_; }
 // SAMPLING FUNCTIONS
 
 std::tuple<size_t, size_t, double> CameraPathModel::sampleSOR(size_t s, size_t a) const {
-#ifdef HALF_VISIBILITY
-    a *= 2;
-    if ( !(A % 2) && ( a / cameraSize_ ) % 2 ) ++a;
-#endif
+    return sampleSOR(s, a, rand_);
+}
+
+std::tuple<size_t, size_t, double> CameraPathModel::sampleSOR(size_t s, size_t a, RandomEngine & rand) const {
+    a = convertAction(a);
 
-    size_t s1 = sampleTransition(s);
-    size_t o = sampleObservation(s1, a);
+    size_t s1 = sampleTransition(s, rand);
+    size_t o = sampleObservation(s1, a, rand);
 
     return std::make_tuple(s1, o, 0.0);
 }
 
-std::tuple<size_t, double> CameraPathModel::sampleOR(size_t, size_t a, size_t s1) const {
-#ifdef HALF_VISIBILITY
-    a *= 2;
-    if ( !(A % 2) && ( a / cameraSize_ ) % 2 ) ++a;
-#endif
+// Here we first move all targets, and then check all cameras in a single
+// loop. Only the targets which end up under their camera need the random
+// noise of the observation, which is added last.
+void CameraPathModel::sampleSORBatch(const std::vector<size_t> & states, const std::vector<size_t> & actions, std::vector<std::tuple<size_t, size_t, double>> & out, RandomEngine & rand) const {
+    const size_t n = states.size();
+    out.resize(n);
+
+    for ( size_t i = 0; i < n; ++i )
+        out[i] = std::make_tuple(sampleTransition(states[i], rand), 0, 0.0);
+
+    for ( size_t i = 0; i < n; ++i )
+        std::get<1>(out[i]) = checkCameraField(convertAction(actions[i]), convertToNormalState(std::get<0>(out[i])));
+
+    for ( size_t i = 0; i < n; ++i ) {
+        size_t & o = std::get<1>(out[i]);
+        if ( o ) o = sampleCameraNoise(convertToNormalState(std::get<0>(out[i])), convertAction(actions[i]), o, rand);
+    }
+}
+
+std::tuple<size_t, double> CameraPathModel::sampleOR(size_t s, size_t a, size_t s1) const {
+    return sampleOR(s, a, s1, rand_);
+}
+
+std::tuple<size_t, double> CameraPathModel::sampleOR(size_t, size_t a, size_t s1, RandomEngine & rand) const {
+    return std::make_tuple(sampleObservation(s1, convertAction(a), rand), 0.0);
+}
+
+std::tuple<size_t, double> CameraPathModel::sampleSR(size_t s, size_t a) const {
+    return sampleSR(s, a, goal_, rand_);
+}
 
-    return std::make_tuple(sampleObservation(s1, a), 0.0);
+CameraPathModel::Goal CameraPathModel::sampleGoal(RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> distg(0, gridSize_-1);
+    Goal goal;
+    goal.x = distg(rand); goal.y = distg(rand);
+    return goal;
 }
 
-std::tuple<size_t, double> CameraPathModel::sampleSR(size_t s, size_t) const {
-    return std::make_tuple(sampleTrajectoryTransition(s), 0.0);
+std::tuple<size_t, double> CameraPathModel::sampleSR(size_t s, size_t, Goal & goal, RandomEngine & rand) const {
+    return std::make_tuple(sampleTrajectoryTransition(s, goal, rand), 0.0);
 }
 
 // IMPLEMENTATIONS
 
 // Modified from Basic..
-size_t CameraPathModel::sampleTransition(size_t s) const {
-    static std::uniform_int_distribution<unsigned> dist1(1, 20);
-    static std::uniform_int_distribution<unsigned> dist2(1, 3);
+size_t CameraPathModel::sampleTransition(size_t s, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(1, 20);
+    std::uniform_int_distribution<unsigned> dist2(1, 3);
 
     // From outside
     if ( s == S-1 ) {
         // 0.05 chance for both
-        auto dice = dist1(rand_);
+        auto dice = dist1(rand);
         // Start off walking left
         if ( dice == 19 ) return entranceA_ + gridCells_ * LEFT;
         if ( dice == 20 ) return entranceB_ + gridCells_ * LEFT;
@@ -100,13 +145,13 @@ size_t CameraPathModel::sampleTransition(size_t s) const {
 
     auto preferredDirection = getPreferredDirectionFromState(s);
     auto normalState = convertToNormalState(s);
-    auto dice = dist1(rand_);
+    auto dice = dist1(rand);
 
     auto newDirection = preferredDirection;
 
     // 0.85 % of choosing preferred direction.
     if ( dice > preferredPathProbabilityD20 ) {
-        newDirection = dist2(rand_);
+        newDirection = dist2(rand);
         // This we do since dist2 does not produce 0.
         if ( newDirection == preferredDirection ) newDirection = 0;
     }
@@ -117,14 +162,12 @@ size_t CameraPathModel::sampleTransition(size_t s) const {
     return newState + gridCells_ * newDirection;
 }
 
-size_t CameraPathModel::sampleTrajectoryTransition(size_t s) const {
-    static std::uniform_int_distribution<unsigned> dist1(0, 9);
-    static std::uniform_int_distribution<unsigned> distg(0, gridSize_-1);
-    static size_t xg = 0, yg = 0;
+size_t CameraPathModel::sampleTrajectoryTransition(size_t s, Goal & goal, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(0, 9);
 
-    if ( s == coordToState(xg, yg) || dist1(rand_) == 0 ) {
-        xg = distg(rand_); yg = distg(rand_);
-    }
+    if ( s == coordToState(goal.x, goal.y) || dist1(rand) == 0 )
+        goal = sampleGoal(rand);
+    const size_t xg = goal.x, yg = goal.y;
 
     size_t x, y;
     std::tie(x, y) = stateToCoord(s);
@@ -138,18 +181,20 @@ size_t CameraPathModel::sampleTrajectoryTransition(size_t s) const {
     return getNextDirState(s, dir);
 }
 
-double computePrecision(int puc, int data) {
+static double computePrecision(int puc, int data) {
     // 0.5-1
     return 1.0 - ( std::abs(puc - data/2 - 1) / (double) data );
 }
 
-size_t CameraPathModel::sampleObservation(size_t s1, size_t a) const {
-    static std::uniform_int_distribution<unsigned> dist1(0, 4);
-    static std::uniform_real_distribution<double>  prob(0, 1);
-
+size_t CameraPathModel::sampleObservation(size_t s1, size_t a, RandomEngine & rand) const {
     // Modified this line from Basic
     s1 = convertToNormalState(s1);
-    size_t positionUnderCamera = checkCameraField(a, s1);
+    return sampleCameraNoise(s1, a, checkCameraField(a, s1), rand);
+}
+
+size_t CameraPathModel::sampleCameraNoise(size_t s1, size_t a, size_t positionUnderCamera, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(0, 4);
+    std::uniform_real_distribution<double>  prob(0, 1);
 
     // If the person is under the camera, we see it more correctly
     // towards the center, and worse towards the edges (not exactly
@@ -159,9 +204,9 @@ size_t CameraPathModel::sampleObservation(size_t s1, size_t a) const {
         double precision = computePrecision(positionUnderCamera, cameraData[a][0]);
 
         // Camera worked correctly
-        if ( precision > prob(rand_) ) return positionUnderCamera;
+        if ( precision > prob(rand) ) return positionUnderCamera;
         // We return a state close to the one we saw (kind of noise..) or nothing
-        int cameraCheck = dist1(rand_);
+        int cameraCheck = dist1(rand);
         if ( cameraCheck == 4 ) return positionUnderCamera;
         return checkCameraField( a, getNextDirState(s1, cameraCheck) );
     }
@@ -213,9 +258,71 @@ double CameraPathModel::getTransitionProbability(size_t s, size_t, size_t s1) co
     return 0.0;
 }
 
+// SPARSE PROBABILITIES
+
+// This adds p to the probability of x in the list, adding x if it is not
+// there yet.
+static void addOutcome(std::vector<std::pair<size_t, double>> & out, size_t x, double p) {
+    for ( auto & outcome : out ) {
+        if ( outcome.first == x ) {
+            outcome.second += p;
+            return;
+        }
+    }
+    out.emplace_back(x, p);
+}
+
+void CameraPathModel::getSuccessors(size_t s, size_t, std::vector<std::pair<size_t, double>> & out) const {
+    out.clear();
+    if ( s == S-1 ) {
+        out.emplace_back(s, 0.9);
+        out.emplace_back(entranceA_ + gridCells_ * LEFT, 0.05);
+        // With an odd grid both entrances are the same cell.
+        if ( entranceB_ != entranceA_ ) out.emplace_back(entranceB_ + gridCells_ * LEFT, 0.05);
+        return;
+    }
+    auto preferredDirection = getPreferredDirectionFromState(s);
+    auto normalState = convertToNormalState(s);
+
+    for ( int i = 0; i < 4; ++i ) {
+        auto s1 = getNextDirState(normalState, i);
+        // As in getTransitionProbability, walking outside is not accounted for.
+        if ( s1 == S-1 ) continue;
+        out.emplace_back(s1 + gridCells_ * i, i == preferredDirection ? preferredPathProbability : nonPreferredPathProbability);
+    }
+}
+
+void CameraPathModel::getObservations(size_t s1, size_t a, std::vector<std::pair<size_t, double>> & out) const {
+    out.clear();
+    s1 = convertToNormalState(s1);
+    size_t positionUnderCamera = checkCameraField(a, s1);
+
+    if ( !positionUnderCamera ) {
+        out.emplace_back(0, 1.0);
+        return;
+    }
+    double precision = computePrecision(positionUnderCamera, cameraData[a][0]);
+    double error = (1.0 - precision)/5.0;
+
+    // As in getObservationProbability, the correct observation does not
+    // accumulate the error of neighbours which map back to it.
+    out.emplace_back(positionUnderCamera, precision + error);
+    for ( unsigned i = 0; i < 4; ++i ) {
+        size_t o = checkCameraField(a, getNextDirState(s1, i));
+        if ( o != positionUnderCamera ) addOutcome(out, o, error);
+    }
+}
+
 // MOVEMENT AND CAMERA CODE
 
 size_t CameraPathModel::getNextDirState(size_t s, unsigned dir) const {
+    assert(dir < 4);
+    // Trajectories may move states which still include the direction.
+    if ( s >= gridCells_ ) return computeNextDirState(s, dir);
+    return neighbours_[s][dir];
+}
+
+size_t CameraPathModel::computeNextDirState(size_t s, unsigned dir) const {
     size_t s1;
     switch ( dir ) {
         case 0:
@@ -239,31 +346,16 @@ size_t CameraPathModel::getNextDirState(size_t s, unsigned dir) const {
 
 size_t CameraPathModel::checkCameraField(size_t a, size_t s) const {
     assert(a < A);
-    if ( s == S - 1 ) return 0;
-
-    int x, y;
-    std::tie(x,y) = stateToCoord(s);
-
-    int positionUnderCameraX, positionUnderCameraY;
-    positionUnderCameraX = x - static_cast<int>(cameraData[a][1]);
-    positionUnderCameraY = y - static_cast<int>(cameraData[a][2]);
-
-    size_t positionUnderCamera;
-    if ( positionUnderCameraX < 0 || positionUnderCameraY < 0 || positionUnderCameraX >= cameraField || positionUnderCameraY >= cameraField )
-        positionUnderCamera = 0;
-    else
-        positionUnderCamera = positionUnderCameraX + positionUnderCameraY * cameraData[a][3] + 1;
+    if ( s >= gridCells_ ) return 0;
 
-    return positionUnderCamera;
+    const auto & camera = cellCameras_[s];
+    return camera[0] == a ? camera[1] : 0;
 }
 
 bool CameraPathModel::isTerminal(size_t) const { return false; }
 
 void CameraPathModel::visualize(const std::vector<size_t> & positions, size_t camera) const {
-#ifdef HALF_VISIBILITY
-    camera *= 2;
-    if ( !(A % 2) && ( camera / cameraSize_ ) % 2 ) ++camera;
-#endif
+    camera = convertAction(camera);
 
     for ( unsigned y = 0; y < gridSize_; ++y ) {
         for ( unsigned x = 0; x < gridSize_; ++x ) {
@@ -280,6 +372,14 @@ void CameraPathModel::visualize(const std::vector<size_t> & positions, size_t ca
     }
 }
 
+size_t CameraPathModel::convertAction(size_t a) const {
+#ifdef HALF_VISIBILITY
+    a *= 2;
+    if ( !(A % 2) && ( a / cameraSize_ ) % 2 ) ++a;
+#endif
+    return a;
+}
+
 int CameraPathModel::getPreferredDirectionFromState(size_t s) const {
     return s == S-1 ? 0 : s / gridCells_;
 }
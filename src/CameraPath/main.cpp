@@ -4,6 +4,7 @@
 #include <AIToolbox/POMDP/Policies/Policy.hpp>
 
 #include <MasterThesis/Algorithms/rPOMCP.hpp>
+#include <MasterThesis/Algorithms/rPOMCPMulti.hpp>
 #include <MasterThesis/Algorithms/RTBSSb.hpp>
 #include <MasterThesis/CameraPath/cameraPathProblem.hpp>
 #include <MasterThesis/makeExperimentPOMCP.hpp>
@@ -13,14 +14,21 @@
 #include <iostream>
 #include <fstream>
 
+// The knowledge measure used as reward by the belief-dependent solvers is
+// selected at compile time, so we instantiate the experiments for both.
+template <typename K>
+int run(int argc, char * argv[]);
+
 int main(int argc, char * argv[]) {
-    using namespace AIToolbox;
     // We register to this so if the user does Ctrl-C
     // we still save the results on file.
     registerSigInt();
+    // If SEED is set all randomness derives from it, so the run can be replayed.
+    RandomStreams::setMasterSeedFromEnvironment();
 
     if ( argc > 1 && std::string(argv[1]) == "help" ) {
-        std::cout << "solver     ==> 1: rPOMCP; 3: RTBSSb; 4: rPOMCP multi\n"
+        std::cout << "solver     ==> 1: rPOMCP; 3: RTBSSb; 4: rPOMCP multi; 5: rPOMCP joint multi\n"
+                     "measure    ==> 0: entropy; 1: max of belief\n"
                      "gridSize   ==> width/height of the room\n"
                      "initState  ==> the initial state, or gridSize^2+1 for uniform\n"
                      "solverHor  ==> the solver horizon\n"
@@ -29,33 +37,49 @@ int main(int argc, char * argv[]) {
                      "k          ==> the max trigger for rPOMCP\n"
                      "numExp     ==> number of episodes to do\n"
                      "filename   ==> where to save results\n"
-                     "[nrPpl]    ==> number of people in multi experiment\n";
+                     "[nrPpl]    ==> number of people in multi experiment, not given for RTBSSb\n"
+                     "[threads]  ==> number of threads planning for the people, or searching in RTBSSb, default 1\n"
+                     "\nSet the SEED environment variable to replay a run exactly.\n";
         return 0;
     }
 
-    if ( argc < 10 ) {
-        std::cout << "Usage: " << argv[0] << " [help] solver gridSize initState solverHor modelHor iterations k numExp filename nrPpl\n";
+    if ( argc < 11 ) {
+        std::cout << "Usage: " << argv[0] << " [help] solver measure gridSize initState solverHor modelHor iterations k numExp filename nrPpl\n";
         return 0;
     }
 
+    if ( std::stoi(argv[2]) )
+        return run<MaxBelief>(argc, argv);
+    return run<Entropy>(argc, argv);
+}
+
+template <typename K>
+int run(int argc, char * argv[]) {
+    using namespace AIToolbox;
+
     unsigned solver         = std::stoi(argv[1]);
-    unsigned gridSize       = std::stoi(argv[2]);
-    unsigned initState      = std::stoi(argv[3]);
-    unsigned solverHor      = std::stoi(argv[4]);
-    unsigned modelHor       = std::stoi(argv[5]);
-    unsigned iterations     = std::stod(argv[6]);
-    unsigned k              = std::stod(argv[7]);
-    unsigned numExp         = std::stoi(argv[8]);
-    std::string filename    = argv[9];
+    unsigned gridSize       = std::stoi(argv[3]);
+    unsigned initState      = std::stoi(argv[4]);
+    unsigned solverHor      = std::stoi(argv[5]);
+    unsigned modelHor       = std::stoi(argv[6]);
+    unsigned iterations     = std::stod(argv[7]);
+    unsigned k              = std::stod(argv[8]);
+    unsigned numExp         = std::stoi(argv[9]);
+    std::string filename    = argv[10];
     unsigned nrPpl          = 1;
+    unsigned threads        = 1;
 
-    if ( solver == 4 ) {
-        if ( argc < 11 ) {
-            std::cout << "Usage: " << argv[0] << " [help] solver gridSize initState solverHor modelHor iterations k numExp filename nrPpl\n";
+    if ( solver == 4 || solver == 5 ) {
+        if ( argc < 12 ) {
+            std::cout << "Usage: " << argv[0] << " [help] solver measure gridSize initState solverHor modelHor iterations k numExp filename nrPpl [threads]\n";
             return 0;
         }
-        nrPpl               = std::stoi(argv[10]);
+        nrPpl               = std::stoi(argv[11]);
+        if ( argc > 12 )
+            threads         = std::stoi(argv[12]);
     }
+    else if ( solver == 3 && argc > 11 )
+        threads             = std::stoi(argv[11]);
 
     double discount = 0.9;
 
@@ -82,38 +106,32 @@ int main(int argc, char * argv[]) {
 
     switch ( solver ) {
         case 1: {
-            auto pomcp = rPOMCP<decltype(model)>(model, 1000, iterations, 5, k);
+            auto pomcp = rPOMCP<decltype(model), K>(model, 1000, iterations, 5, k);
             // We use trajectories so targets move in a realistic way
             makeExperimentPOMCP(numExp, modelHor, model, belief, solverHor, pomcp, belief, filename, true);
             break;
         }
         case 3: {
-#ifdef ENTROPY
-            auto function = [](const POMDP::Belief & b) {
-                double e = 0.0;
-                for ( auto v : b )
-                    if ( checkDifferentSmall(v, 0.0) ) e += v * std::log(v);
-                return e;
-            };
-            auto rtbss = RTBSSb<decltype(model)>(model, 0, function);
-#else
-            auto function = [](const POMDP::Belief & b) {
-                return *std::max_element(std::begin(b), std::end(b));
-            };
-            auto rtbss = RTBSSb<decltype(model)>(model, 1, function);
-#endif
+            auto rtbss = RTBSSb<decltype(model), K>(model, K::maxValue(), threads);
             // We use trajectories so targets move in a realistic way
             makeExperimentRTBSS(numExp, modelHor, model, belief, solverHor, rtbss, belief, filename, true);
             break;
         }
         case 4: {
             std::cout << "USING MULTIPLE PEOPLE: " << nrPpl << '\n';
-            std::vector<rPOMCP<decltype(model)>> solvers;
+            std::vector<rPOMCP<decltype(model), K>> solvers;
             solvers.reserve(nrPpl);
             for ( unsigned i = 0; i < nrPpl; ++i )
                 solvers.emplace_back(model, 1000, iterations, 5, k);
 
-            makeMultiExperimentPOMCP(numExp, nrPpl, modelHor, model, belief, solverHor, solvers, belief, filename, true);
+            makeMultiExperimentPOMCP(numExp, nrPpl, modelHor, model, belief, solverHor, solvers, belief, filename, true, threads);
+            break;
+        }
+        case 5: {
+            std::cout << "USING MULTIPLE PEOPLE IN A SINGLE TREE: " << nrPpl << '\n';
+            auto pomcp = rPOMCPMulti<decltype(model), K>(model, MultiTarget(model, nrPpl), 1000, iterations, 5, k);
+
+            makeMultiExperimentPOMCP(numExp, nrPpl, modelHor, model, belief, solverHor, pomcp, belief, filename, true);
             break;
         }
     }
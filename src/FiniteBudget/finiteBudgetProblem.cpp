@@ -1,10 +1,9 @@
 #include <MasterThesis/FiniteBudget/finiteBudgetProblem.hpp>
 
 #include <cassert>
-#include <AIToolbox/Impl/Seeder.hpp>
 
 FiniteBudgetModel::FiniteBudgetModel(unsigned worldWidth, double leftP, size_t maxBudget, double d) : S(worldWidth * (maxBudget+2)), A(worldWidth + 1), discount_(d),
-                                                                                                      maxBudget_(maxBudget), worldWidth_(worldWidth), rand_(AIToolbox::Impl::Seeder::getSeed())
+                                                                                                      maxBudget_(maxBudget), worldWidth_(worldWidth), rand_(RandomStreams::getSeed())
 {
     if ( worldWidth < 1 ) throw std::invalid_argument("This grid size is not allowed: " + std::to_string(worldWidth));
     cameraPrecision_ = 0.8;
@@ -24,26 +23,38 @@ double FiniteBudgetModel::getDiscount() const { return discount_; }
 // SAMPLING FUNCTIONS
 
 std::tuple<size_t, size_t, double> FiniteBudgetModel::sampleSOR(size_t s, size_t a) const {
+    return sampleSOR(s, a, rand_);
+}
+
+std::tuple<size_t, size_t, double> FiniteBudgetModel::sampleSOR(size_t s, size_t a, RandomEngine & rand) const {
     auto trueS = convertToNormalState(s);
     auto budget = getRemainingBudget(s);
 
-    size_t trueS1 = sampleTransition(trueS);
+    size_t trueS1 = sampleTransition(trueS, rand);
     auto s1 = makeState(trueS1, a == worldWidth_ ? budget : budget + 1);
 
-    size_t o = sampleObservation(s1, a);
+    size_t o = sampleObservation(s1, a, rand);
 
     return std::make_tuple(s1, o, 0.0);
 }
 
-std::tuple<size_t, double> FiniteBudgetModel::sampleOR(size_t, size_t a, size_t s1) const {
-    return std::make_tuple(sampleObservation(s1, a), 0.0);
+std::tuple<size_t, double> FiniteBudgetModel::sampleOR(size_t s, size_t a, size_t s1) const {
+    return sampleOR(s, a, s1, rand_);
+}
+
+std::tuple<size_t, double> FiniteBudgetModel::sampleOR(size_t, size_t a, size_t s1, RandomEngine & rand) const {
+    return std::make_tuple(sampleObservation(s1, a, rand), 0.0);
 }
 
 std::tuple<size_t, double> FiniteBudgetModel::sampleSR(size_t s, size_t a) const {
+    return sampleSR(s, a, rand_);
+}
+
+std::tuple<size_t, double> FiniteBudgetModel::sampleSR(size_t s, size_t a, RandomEngine & rand) const {
     auto trueS = convertToNormalState(s);
     auto budget = getRemainingBudget(s);
 
-    size_t trueS1 = sampleTrajectoryTransition(trueS);
+    size_t trueS1 = sampleTrajectoryTransition(trueS, rand);
     auto s1 = makeState(trueS1, a == worldWidth_ ? budget : budget + 1);
     return std::make_tuple(s1, 0.0);
 }
@@ -51,10 +62,10 @@ std::tuple<size_t, double> FiniteBudgetModel::sampleSR(size_t s, size_t a) const
 // IMPLEMENTATIONS
 
 // TAKES TRUE STATE
-size_t FiniteBudgetModel::sampleTransition(size_t s) const {
-    static std::uniform_real_distribution<double> prob(0, 1);
+size_t FiniteBudgetModel::sampleTransition(size_t s, RandomEngine & rand) const {
+    std::uniform_real_distribution<double> prob(0, 1);
 
-    auto dice = prob(rand_);
+    auto dice = prob(rand);
     // Moving to the right..
     if ( dice > leftProbability_ )
         return (s+1)%worldWidth_;
@@ -62,16 +73,16 @@ size_t FiniteBudgetModel::sampleTransition(size_t s) const {
     return (s-1+worldWidth_)%worldWidth_;
 }
 
-size_t FiniteBudgetModel::sampleTrajectoryTransition(size_t s) const {
-    return sampleTransition(s);
+size_t FiniteBudgetModel::sampleTrajectoryTransition(size_t s, RandomEngine & rand) const {
+    return sampleTransition(s, rand);
 }
 
 // TAKES FAKE STATE
-size_t FiniteBudgetModel::sampleObservation(size_t s1, size_t a) const {
+size_t FiniteBudgetModel::sampleObservation(size_t s1, size_t a, RandomEngine & rand) const {
     auto budget = getRemainingBudget(s1);
-    static std::uniform_real_distribution<double> prob(0, 1);
+    std::uniform_real_distribution<double> prob(0, 1);
 
-    auto dice = prob(rand_);
+    auto dice = prob(rand);
     // If there's no more budget, or we don't look..
     if ( budget > maxBudget_ || a == worldWidth_ ) {
         return dice > 0.5;
@@ -15,14 +15,21 @@
 #include <iostream>
 #include <fstream>
 
+// The knowledge measure used as reward by the belief-dependent solvers is
+// selected at compile time, so we instantiate the experiments for both.
+template <typename K>
+int run(int argc, char * argv[]);
+
 int main(int argc, char * argv[]) {
-    using namespace AIToolbox;
     // We register to this so if the user does Ctrl-C
     // we still save the results on file.
     registerSigInt();
+    // If SEED is set all randomness derives from it, so the run can be replayed.
+    RandomStreams::setMasterSeedFromEnvironment();
 
     if ( argc > 1 && std::string(argv[1]) == "help" ) {
         std::cout << "solver     ==> 0: POMCP(IR); 1: rPOMCP; 2: RTBSS(IR); 3: RTBSSb\n"
+                     "measure    ==> 0: entropy; 1: max of belief\n"
                      "worldWidth ==> width of the room\n"
                      "initState  ==> the initial state, or gridSize^2+1 for uniform\n"
                      "solverHor  ==> the solver horizon\n"
@@ -32,26 +39,36 @@ int main(int argc, char * argv[]) {
                      "numExp     ==> number of episodes to do\n"
                      "filename   ==> where to save results\n"
                      "budget     ==> number of available observing actions\n"
-                     "leftP      ==> probability of the target to transition to the left\n";
+                     "leftP      ==> probability of the target to transition to the left\n"
+                     "\nSet the SEED environment variable to replay a run exactly.\n";
         return 0;
     }
 
-    if ( argc < 12 ) {
-        std::cout << "Usage: " << argv[0] << " [help] solver worldWidth initState solverHor modelHor iterations k numExp filename budget leftP\n";
+    if ( argc < 13 ) {
+        std::cout << "Usage: " << argv[0] << " [help] solver measure worldWidth initState solverHor modelHor iterations k numExp filename budget leftP\n";
         return 0;
     }
 
+    if ( std::stoi(argv[2]) )
+        return run<MaxBelief>(argc, argv);
+    return run<Entropy>(argc, argv);
+}
+
+template <typename K>
+int run(int, char * argv[]) {
+    using namespace AIToolbox;
+
     unsigned solver         = std::stoi(argv[1]);
-    unsigned worldWidth     = std::stoi(argv[2]);
-    unsigned initState      = std::stoi(argv[3]);
-    unsigned solverHor      = std::stoi(argv[4]);
-    unsigned modelHor       = std::stoi(argv[5]);
-    unsigned iterations     = std::stod(argv[6]);
-    unsigned k              = std::stod(argv[7]);
-    unsigned numExp         = std::stoi(argv[8]);
-    std::string filename    = argv[9];
-    unsigned budget         = std::stoi(argv[10]);
-    double leftP            = std::stod(argv[11]);
+    unsigned worldWidth     = std::stoi(argv[3]);
+    unsigned initState      = std::stoi(argv[4]);
+    unsigned solverHor      = std::stoi(argv[5]);
+    unsigned modelHor       = std::stoi(argv[6]);
+    unsigned iterations     = std::stod(argv[7]);
+    unsigned k              = std::stod(argv[8]);
+    unsigned numExp         = std::stoi(argv[9]);
+    std::string filename    = argv[10];
+    unsigned budget         = std::stoi(argv[11]);
+    double leftP            = std::stod(argv[12]);
 
     double discount = 0.9;
 
@@ -71,7 +88,7 @@ int main(int argc, char * argv[]) {
         }
         case 1: {
             auto model = FiniteBudgetModel(worldWidth, leftP, budget, discount);
-            auto pomcp = rPOMCP<decltype(model)>(model, 1000, iterations, 5, k);
+            auto pomcp = rPOMCP<decltype(model), K>(model, 1000, iterations, 5, k);
             // We use trajectories so targets move in a realistic way
             makeExperimentPOMCP(numExp, modelHor, model, belief, solverHor, pomcp, belief, filename, true);
             break;
@@ -84,20 +101,7 @@ int main(int argc, char * argv[]) {
         }
         case 3: {
             auto model = FiniteBudgetModel(worldWidth, leftP, budget, discount);
-#ifndef ENTROPY
-            auto function = [](const POMDP::Belief & b) {
-                double e = 0.0;
-                for ( auto v : b )
-                    if ( checkDifferentSmall(v, 0.0) ) e += v * std::log(v);
-                return e;
-            };
-            auto rtbss = RTBSSb<decltype(model)>(model, 0, function);
-#else
-            auto function = [](const POMDP::Belief & b) {
-                return *std::max_element(std::begin(b), std::end(b));
-            };
-            auto rtbss = RTBSSb<decltype(model)>(model, 1, function);
-#endif
+            auto rtbss = RTBSSb<decltype(model), K>(model);
             // We use trajectories so targets move in a realistic way
             makeExperimentRTBSS(numExp, modelHor, model, belief, solverHor, rtbss, belief, filename, true);
             break;
@@ -1,8 +1,6 @@
 #include <MasterThesis/Myopic/myopicProblemIR.hpp>
 
-#include <AIToolbox/Impl/Seeder.hpp>
-
-MyopicModelIR::MyopicModelIR(size_t s, double d) : size_(s), S(size_ * 2), A(S*S), discount_(d), rand_(AIToolbox::Impl::Seeder::getSeed())  {
+MyopicModelIR::MyopicModelIR(size_t s, double d) : size_(s), S(size_ * 2), A(S*S), discount_(d), rand_(RandomStreams::getSeed())  {
     if ( size_ < 1 ) throw std::invalid_argument("This size is not allowed: " + std::to_string(size_));
 }
 
@@ -12,36 +10,44 @@ size_t MyopicModelIR::getO() const { return 2; }
 double MyopicModelIR::getDiscount() const { return discount_; }
 
 std::tuple<size_t, size_t, double> MyopicModelIR::sampleSOR(size_t s, size_t a) const {
-    size_t s1 = sampleTransition(s);
+    return sampleSOR(s, a, rand_);
+}
+
+std::tuple<size_t, size_t, double> MyopicModelIR::sampleSOR(size_t s, size_t a, RandomEngine & rand) const {
+    size_t s1 = sampleTransition(s, rand);
 
     size_t an, ap;
     std::tie(an, ap) = decodeAction(a);
 
-    size_t o = sampleObservation(s1, an);
+    size_t o = sampleObservation(s1, an, rand);
 
     return std::make_tuple(s1, o, s == ap);
 }
 
 std::tuple<size_t, double> MyopicModelIR::sampleOR(size_t s, size_t a, size_t s1) const {
+    return sampleOR(s, a, s1, rand_);
+}
+
+std::tuple<size_t, double> MyopicModelIR::sampleOR(size_t s, size_t a, size_t s1, RandomEngine & rand) const {
     size_t an, ap;
     std::tie(an, ap) = decodeAction(a);
-    return std::make_tuple(sampleObservation(s1, an), s == ap);
+    return std::make_tuple(sampleObservation(s1, an, rand), s == ap);
 }
 
-size_t MyopicModelIR::sampleTransition(size_t s) const {
-    static std::uniform_int_distribution<unsigned> dist(0, size_-1);
+size_t MyopicModelIR::sampleTransition(size_t s, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist(0, size_-1);
 
     // Random side
-    if ( s < size_ ) return dist(rand_);
+    if ( s < size_ ) return dist(rand);
 
     // Deterministic side
     return (((( s - size_ ) + 1) % size_ ) + size_);
 }
 
-size_t MyopicModelIR::sampleObservation(size_t s1, size_t an) const {
-    static std::uniform_int_distribution<unsigned> dist1(1, 5);
+size_t MyopicModelIR::sampleObservation(size_t s1, size_t an, RandomEngine & rand) const {
+    std::uniform_int_distribution<unsigned> dist1(1, 5);
     // 0.2 chance of failing
-    bool cameraWorks = (dist1(rand_) != 5);
+    bool cameraWorks = (dist1(rand) != 5);
 
     if ( cameraWorks ) {
         return s1 == an;
@@ -52,14 +58,17 @@ size_t MyopicModelIR::sampleObservation(size_t s1, size_t an) const {
 }
 
 std::tuple<size_t, double> MyopicModelIR::sampleSR(size_t s, size_t a) const {
+    return sampleSR(s, a, rand_);
+}
+
+std::tuple<size_t, double> MyopicModelIR::sampleSR(size_t s, size_t a, RandomEngine & rand) const {
     size_t ap;
     std::tie(std::ignore, ap) = decodeAction(a);
-    return std::make_tuple(sampleTransition(s), s == ap);
+    return std::make_tuple(sampleTransition(s, rand), s == ap);
 }
 
 bool MyopicModelIR::isTerminal(size_t) const { return false; }
 
-
 double MyopicModelIR::getTransitionProbability(size_t s, size_t, size_t s1) const {
     // If they are both in the random part, it's possible
     if ( s < size_ && s1 < size_ ) return 1.0/size_;